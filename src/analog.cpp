@@ -38,6 +38,7 @@
 
 #include "gptokeyb.h"
 
+#include <algorithm>
 #include <cmath>
 
 /* Code based on:
@@ -170,10 +171,9 @@ void dz_default(int &x, int &y, int in_x, int in_y)
     y = applyDeadzone(in_y, config.deadzone_y) / config.fake_mouse_scale;
 }
 
-void deadzone_calc(int &x, int &y, int in_x, int in_y)
+// Applies the configured deadzone mode to a stick position from -1 to 1, false for the default mode
+static bool dz_apply(Vector2D &stick_output, const Vector2D &stick_input)
 {
-    Vector2D stick_input((float)(in_x) / 32768.0, (float)(in_y) / 32768.0);
-    Vector2D stick_output;
     float dz = (float)(config.deadzone) / 32768.0;
 
     switch(config.deadzone_mode)
@@ -199,6 +199,17 @@ void deadzone_calc(int &x, int &y, int in_x, int in_y)
 
     default:
     case DZ_DEFAULT:
+        return false;
+    }
+    return true;
+}
+
+void deadzone_calc(int &x, int &y, int in_x, int in_y)
+{
+    Vector2D stick_input((float)(in_x) / 32768.0, (float)(in_y) / 32768.0);
+    Vector2D stick_output;
+
+    if (!dz_apply(stick_output, stick_input)) {
         dz_default(x, y, in_x, in_y);
         return;
     }
@@ -206,3 +217,118 @@ void deadzone_calc(int &x, int &y, int in_x, int in_y)
     x = (int)(stick_output.x * config.deadzone_scale);
     y = (int)(stick_output.y * config.deadzone_scale);
 }
+
+// For mouse_absolute: where the stick is after the deadzone, from -1 to 1 on each axis
+void deadzone_position(float &x, float &y, int in_x, int in_y)
+{
+    Vector2D stick_input((float)(in_x) / 32768.0, (float)(in_y) / 32768.0);
+    Vector2D stick_output;
+
+    if (!dz_apply(stick_output, stick_input)) {
+        stick_output.x = (float)(applyDeadzone(in_x, config.deadzone_x)) / 32768.0;
+        stick_output.y = (float)(applyDeadzone(in_y, config.deadzone_y)) / 32768.0;
+    }
+
+    x = std::max(-1.0f, std::min(1.0f, stick_output.x));
+    y = std::max(-1.0f, std::min(1.0f, stick_output.y));
+}
+
+// Where a stick at in_x/in_y puts the pointer with mouse_absolute, on the absolute device's
+// 0 to absolute_width/height scale. "screen" spreads the stick's reach over the whole screen;
+// "window" only reaches absolute_radius pixels from where the pointer was when the stick left
+// the centre. Returns false if the pointer should stay where it is.
+bool absolute_calc(int &x, int &y, int in_x, int in_y)
+{
+    float pos_x, pos_y;
+    deadzone_position(pos_x, pos_y, in_x, in_y);
+    bool centred = (pos_x == 0.0f && pos_y == 0.0f);
+
+    if (centred && !state.abs_stick_active)
+        return false;
+    if (!state.abs_stick_active) { // just left the centre
+        state.abs_stick_active = true;
+        state.abs_anchor_x = (state.abs_x >= 0 ? state.abs_x : (config.absolute_width - 1) / 2);
+        state.abs_anchor_y = (state.abs_y >= 0 ? state.abs_y : (config.absolute_height - 1) / 2);
+    }
+    if (centred) {
+        state.abs_stick_active = false;
+        if (!config.absolute_recenter)
+            return false;
+    }
+
+    if (config.absolute_window) {
+        x = state.abs_anchor_x + (int)(pos_x * config.absolute_radius);
+        y = state.abs_anchor_y + (int)(pos_y * config.absolute_radius);
+    } else {
+        x = (int)((pos_x + 1.0f) / 2.0f * (config.absolute_width - 1));
+        y = (int)((pos_y + 1.0f) / 2.0f * (config.absolute_height - 1));
+    }
+
+    x = std::max(0, std::min(config.absolute_width - 1, x));
+    y = std::max(0, std::min(config.absolute_height - 1, y));
+    return true;
+}
+
+// Stick angles for the sector mode, without float trig for every event: a table of atan over
+// one octant, folded out to the whole circle. Angles are in 1/1024ths of a turn, counting
+// counter-clockwise from right, with up (negative y from SDL) at 256.
+#define ANGLE_TURN 1024
+#define ANGLE_LUT_SIZE 256
+
+static unsigned short angle_lut[ANGLE_LUT_SIZE + 1];
+static bool angle_lut_ready = false;
+
+int stick_angle(int x, int y)
+{
+    if (!angle_lut_ready) {
+        for (int ii = 0; ii <= ANGLE_LUT_SIZE; ii++)
+            angle_lut[ii] = (unsigned short)std::lround(std::atan((double)ii / ANGLE_LUT_SIZE) * ANGLE_TURN / (2.0 * M_PI));
+        angle_lut_ready = true;
+    }
+
+    int dx = x;
+    int dy = -y;
+    int ax = std::abs(dx);
+    int ay = std::abs(dy);
+    if (ax == 0 && ay == 0)
+        return 0;
+
+    int angle; // within the first quadrant
+    if (ax >= ay)
+        angle = angle_lut[ay * ANGLE_LUT_SIZE / ax];
+    else
+        angle = ANGLE_TURN / 4 - angle_lut[ax * ANGLE_LUT_SIZE / ay];
+
+    if (dx < 0)
+        angle = ANGLE_TURN / 2 - angle;
+    if (dy < 0)
+        angle = ANGLE_TURN - angle;
+    return angle & (ANGLE_TURN - 1);
+}
+
+static bool in_sector(int angle, int sector, int ways, int diagonal, int extra)
+{
+    int half = (ways == 8 ? ((sector & 1) ? diagonal : ANGLE_TURN / 4 - diagonal) : ANGLE_TURN / 4) / 2;
+    int offset = ((angle - sector * ANGLE_TURN / 8) & (ANGLE_TURN - 1));
+    if (offset >= ANGLE_TURN / 2)
+        offset -= ANGLE_TURN;
+    return std::abs(offset) <= half + extra;
+}
+
+// Which direction the stick points in, as 0 (right) to 7 (down-right) counter-clockwise; only
+// the even ones when there are 4 ways. Diagonals are config.analog_diagonal degrees wide, and
+// the current direction is kept until the stick is analog_overlap degrees past its edge.
+int stick_sector(int angle, int ways, int current)
+{
+    int diagonal = config.analog_diagonal * ANGLE_TURN / 360;
+    int overlap = config.analog_overlap * ANGLE_TURN / 360;
+
+    if (current >= 0 && in_sector(angle, current, ways, diagonal, overlap))
+        return current;
+
+    for (int sector = 0; sector < 8; sector += (ways == 8 ? 1 : 2)) {
+        if (in_sector(angle, sector, ways, diagonal, 0))
+            return sector;
+    }
+    return current; // only on the very edge between two sectors
+}
@@ -0,0 +1,325 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+#include "gptokeyb.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+// Button combinations, looked up by the GBTN bitmask of the buttons that are held.
+//
+// A chord fires when one of its trigger buttons is pressed while every other button of the chord
+// is already held. Other held buttons (a d-pad direction, a trigger past its deadzone, a button of
+// an unrelated chord) don't get in the way; when several chords match, the one with the most
+// buttons wins. Buttons that can be held waiting for a chord to complete
+// are deferred: their own key is only sent, as a tap, when they are released without completing
+// one, so a chord never leaks the key of the button that started it. Every button of a chord
+// that fired stays quiet until it is released.
+
+static std::unordered_map<uint, chord> chord_table;
+static uint chord_deferred = GBTN_NONE;
+static std::vector<chord> chord_list; // chord_table, most buttons first
+
+static const struct
+{
+    const char* name;
+    uint button;
+} button_names[] = {
+    {"a", GBTN_A}, {"b", GBTN_B}, {"x", GBTN_X}, {"y", GBTN_Y},
+    {"l1", GBTN_L1}, {"l2", GBTN_L2}, {"l3", GBTN_L3},
+    {"r1", GBTN_R1}, {"r2", GBTN_R2}, {"r3", GBTN_R3},
+    {"up", GBTN_UP}, {"down", GBTN_DOWN}, {"left", GBTN_LEFT}, {"right", GBTN_RIGHT},
+    {"start", GBTN_START}, {"back", GBTN_BACK}, {"guide", GBTN_GUIDE},
+};
+
+uint buttonFromName(const char* name)
+{
+    for (const auto& entry : button_names) {
+        if (strcmp(entry.name, name) == 0)
+            return entry.button;
+    }
+    return GBTN_NONE;
+}
+
+// The buttons acting as hotkey: back and guide, unless HOTKEY or -hotkey picked one
+uint hotkeyButtons()
+{
+    if (hotkey_override)
+        return buttonFromName(hotkey_code);
+    if (emuelec_override)
+        return GBTN_GUIDE;
+    return GBTN_BACK | GBTN_GUIDE;
+}
+
+// "start+a = f5": the last button is the one that completes the chord, "hotkey" stands for
+// whichever buttons are the hotkey.
+bool addConfigChord(const char* buttons, const char* value)
+{
+    chord entry;
+    std::string name;
+
+    for (const char* ch = buttons; ; ch++) {
+        if (*ch != '+' && *ch != '\0') {
+            name += *ch;
+            continue;
+        }
+
+        uint button = GBTN_NONE;
+        if (name == "hotkey") {
+            entry.hotkey = true;
+        } else if ((button = buttonFromName(name.c_str())) == GBTN_NONE) {
+            printf("unknown button '%s' in %s\n", name.c_str(), buttons);
+            return false;
+        }
+        entry.buttons |= button;
+        entry.triggers = button;
+        name.clear();
+
+        if (*ch == '\0')
+            break;
+    }
+    if (entry.triggers == GBTN_NONE) {
+        printf("%s needs to end with a button other than hotkey\n", buttons);
+        return false;
+    }
+
+    short added = configModifier(value);
+    if (added != 0) {
+        for (auto& existing : config.chords) {
+            if (existing.buttons == entry.buttons && existing.hotkey == entry.hotkey)
+                addConfigModifier(existing.code, existing.modifier, added);
+        }
+        return true;
+    }
+
+    if (strcmp(value, "kill") == 0) {
+        entry.action = CHORD_KILL;
+    } else if (strcmp(value, "text_preset") == 0) {
+        entry.action = CHORD_TEXT_PRESET;
+    } else if (strcmp(value, "text_confirm") == 0) {
+        entry.action = CHORD_TEXT_CONFIRM;
+    } else if (strcmp(value, "text_interactive") == 0) {
+        entry.action = CHORD_TEXT_INTERACTIVE;
+    } else if (strncmp(value, "macro:", 6) == 0) {
+        entry.code = addConfigMacro(value + 6);
+    } else if (strncmp(value, "tap:", 4) == 0 || strncmp(value, "hold:", 5) == 0) {
+        entry.code = addConfigTapHold(value);
+    } else {
+        entry.code = configKeyCode(value);
+    }
+
+    for (auto& existing : config.chords) {
+        if (existing.buttons == entry.buttons && existing.hotkey == entry.hotkey) {
+            existing.action = entry.action;
+            existing.code = entry.code;
+            return true;
+        }
+    }
+    config.chords.push_back(entry);
+    return true;
+}
+
+static void addChord(uint buttons, uint triggers, CHORD_ACTION action, short code = 0, short modifier = 0)
+{
+    chord& entry = chord_table[buttons];
+    entry.buttons = buttons;
+    entry.triggers = triggers;
+    entry.action = action;
+    entry.code = code;
+    entry.modifier = modifier;
+}
+
+#define _HOTKEY_CHORD(BUTTON) \
+    addChord(hotkey | GBTN_ ## BUTTON, GBTN_ ## BUTTON, CHORD_KEY, config.BUTTON ## _hk, config.BUTTON ## _hk_modifier);
+
+// Rebuilt whenever the profile or the modes change, so matching a chord is usually a single lookup
+void buildChordTable()
+{
+    uint hotkeys = hotkeyButtons();
+
+    chord_table.clear();
+    for (uint hotkey = 1; hotkey <= hotkeys; hotkey <<= 1) {
+        if (!(hotkeys & hotkey))
+            continue;
+
+        if (kill_mode)
+            addChord(hotkey | GBTN_START, hotkey | GBTN_START, CHORD_KILL);
+
+        if (xbox360_mode)
+            continue; // the buttons themselves go to the virtual controller
+
+        _HOTKEY_CHORD(a)
+        _HOTKEY_CHORD(b)
+        _HOTKEY_CHORD(x)
+        _HOTKEY_CHORD(y)
+        _HOTKEY_CHORD(l1)
+        _HOTKEY_CHORD(l2)
+        _HOTKEY_CHORD(r1)
+        _HOTKEY_CHORD(r2)
+
+        for (const auto& entry : config.chords) {
+            if (entry.hotkey)
+                addChord(entry.buttons | hotkey, entry.triggers, entry.action, entry.code, entry.modifier);
+        }
+    }
+
+    if (!xbox360_mode) {
+        if (textinputpreset_mode) {
+            addChord(GBTN_START | GBTN_LEFT, GBTN_LEFT, CHORD_TEXT_PRESET);
+            addChord(GBTN_START | GBTN_RIGHT, GBTN_RIGHT, CHORD_TEXT_CONFIRM);
+        }
+        if (textinputinteractive_mode)
+            addChord(GBTN_START | GBTN_DOWN, GBTN_DOWN, CHORD_TEXT_INTERACTIVE);
+
+        for (const auto& entry : config.chords) {
+            if (!entry.hotkey)
+                addChord(entry.buttons, entry.triggers, entry.action, entry.code, entry.modifier);
+        }
+    }
+
+    // any button that can be held before the rest of its chord has to wait to see what happens
+    chord_deferred = GBTN_NONE;
+    chord_list.clear();
+    for (const auto& item : chord_table) {
+        const chord& entry = item.second;
+        chord_list.push_back(entry);
+        if (entry.triggers & (entry.triggers - 1)) {
+            chord_deferred |= entry.buttons; // more than one trigger, so any of them can come first
+        } else {
+            chord_deferred |= entry.buttons & ~entry.triggers;
+        }
+    }
+    std::sort(chord_list.begin(), chord_list.end(), [](const chord& a, const chord& b) {
+        int a_count = __builtin_popcount(a.buttons), b_count = __builtin_popcount(b.buttons);
+        if (a_count != b_count)
+            return a_count > b_count;
+        return a.buttons > b.buttons; // same size, any fixed order will do
+    });
+}
+
+static void runChordAction(const chord& entry, bool is_pressed)
+{
+    switch (entry.action) {
+    case CHORD_KEY:
+        emitKey(entry.code, is_pressed, entry.modifier);
+        break;
+
+    case CHORD_KILL:
+        if (is_pressed)
+            doKillMode();
+        break;
+
+    case CHORD_TEXT_PRESET:
+        if (is_pressed && config.text_input_preset != NULL) {
+            printf("text input processing %s\n", config.text_input_preset);
+            processKeys();
+        }
+        break;
+
+    case CHORD_TEXT_CONFIRM:
+        if (is_pressed) {
+            printf("text input Enter key\n");
+            queueKeyTap(KEY_ENTER, 0, 15);
+        }
+        break;
+
+    case CHORD_TEXT_INTERACTIVE:
+        if (is_pressed)
+            startTextInputInteractive();
+        break;
+    }
+}
+
+// Returns true when the button's own key must not be sent for this press
+bool chordButtonDown(uint button)
+{
+    state.button_state |= button;
+
+    const chord* match = NULL;
+    auto it = chord_table.find(state.button_state);
+    if (it != chord_table.end() && (it->second.triggers & button)) {
+        match = &it->second;
+    } else {
+        // something else is held too, take the biggest chord that is complete
+        for (const auto& entry : chord_list) {
+            if ((entry.triggers & button) && (state.button_state & entry.buttons) == entry.buttons) {
+                match = &entry;
+                break;
+            }
+        }
+    }
+
+    if (match != NULL) {
+        state.chord_consumed |= match->buttons;
+        state.chord_pending &= ~match->buttons;
+        state.active_chords.push_back(*match);
+        runChordAction(*match, true);
+        return true;
+    }
+
+    if (chord_deferred & button) {
+        state.chord_pending |= button;
+        return true;
+    }
+    return false;
+}
+
+// Releases the chords the button was part of, and says what to do with the button's own key
+CHORD_RELEASE chordButtonUp(uint button)
+{
+    state.button_state &= ~button;
+
+    for (size_t ii = 0; ii < state.active_chords.size();) {
+        if (state.active_chords[ii].buttons & button) {
+            chord entry = state.active_chords[ii];
+            state.active_chords.erase(state.active_chords.begin() + ii);
+            runChordAction(entry, false);
+        } else {
+            ii++;
+        }
+    }
+
+    if (state.chord_consumed & button) {
+        state.chord_consumed &= ~button;
+        return CHORD_RELEASE_NONE;
+    }
+    if (state.chord_pending & button) {
+        state.chord_pending &= ~button;
+        return CHORD_RELEASE_TAP;
+    }
+    return CHORD_RELEASE_KEY;
+}
@@ -37,38 +37,60 @@
 
 #include "gptokeyb.h"
 
+static std::string trimConfigText(const std::string& text)
+{
+    size_t start = text.find_first_not_of(" \t\r\n");
+    size_t end = text.find_last_not_of(" \t\r\n");
+    if (start == std::string::npos)
+        return "";
+    return text.substr(start, end - start + 1);
+}
+
+// One "key = value" per line. The value runs to the end of the line, so it may contain spaces
+// (e.g. "l1 = tap:tab hold:leftshift"); lines starting with # and anything after " #" are comments.
 std::vector<config_option> parseConfigFile(const char* path)
 {
     std::vector<config_option> result;
+    char line[CONFIG_ARG_MAX_BYTES * 2 + 16];
 
     FILE* fp;
 
-    if ((fp = fopen(path, "r+")) == NULL) {
+    if ((fp = fopen(path, "r")) == NULL) {
         perror("fopen()");
         return result;
     }
 
-    while (1) {
-        result.emplace_back();
-        auto& co = result.back();
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        std::string text = trimConfigText(line);
+        if (text.empty() || text[0] == '#')
+            continue;
 
-        if (fscanf(fp, "%s = %s", &co.key[0], &co.value[0]) != 2) {
-            if (feof(fp)) {
-                break;
-            }
+        size_t equals = text.find('=');
+        if (equals == std::string::npos || equals == 0) {
+            printf("ignoring config line: %s\n", text.c_str());
+            continue;
+        }
 
-            if (co.key[0] == '#') {
-                while (fgetc(fp) != '\n') {
-                    // Do nothing (to move the cursor to the end of the line).
-                }
-                result.pop_back();
-                continue;
+        std::string key = trimConfigText(text.substr(0, equals));
+        std::string value = trimConfigText(text.substr(equals + 1));
+        size_t comment = value.find_first_of(" \t", 0);
+        while (comment != std::string::npos) {
+            size_t next = value.find_first_not_of(" \t", comment);
+            if (next != std::string::npos && value[next] == '#') {
+                value = trimConfigText(value.substr(0, comment));
+                break;
             }
+            comment = value.find_first_of(" \t", next);
+        }
 
-            perror("fscanf()");
-            result.pop_back();
+        if (key.empty() || value.empty() || key.size() >= CONFIG_ARG_MAX_BYTES || value.size() >= CONFIG_ARG_MAX_BYTES) {
+            printf("ignoring config line: %s\n", text.c_str());
             continue;
         }
+
+        result.emplace_back();
+        strcpy(result.back().key, key.c_str());
+        strcpy(result.back().value, value.c_str());
     }
 
     fclose(fp);
@@ -79,16 +101,17 @@ std::vector<config_option> parseConfigFile(const char* path)
 
 // UGLY, but works.
 #define _KEY_CONFIG_EXTRA(KEY) \
-    if (strcmp(co.value, "add_alt") == 0) { config.KEY ## _modifier |= KEY_LEFTALT; } \
-    else if (strcmp(co.value, "add_ctrl") == 0) { config.KEY ## _modifier |= KEY_LEFTCTRL; } \
-    else if (strcmp(co.value, "add_shift") == 0) { config.KEY ## _modifier |= KEY_LEFTSHIFT; } \
-    else { config.KEY = char_to_keycode(co.value); }
+    if (configModifier(co.value) != 0) { addConfigModifier(config.KEY, config.KEY ## _modifier, configModifier(co.value)); } \
+    else if (strncmp(co.value, "macro:", 6) == 0) { config.KEY = addConfigMacro(co.value + 6); } \
+    else if (strncmp(co.value, "tap:", 4) == 0 || strncmp(co.value, "hold:", 5) == 0) { config.KEY = addConfigTapHold(co.value); } \
+    else { config.KEY = configKeyCode(co.value); }
 
 #define _KEY_CONFIG_EXTRA_W_REPEAT(KEY) \
     if (strcmp(co.value, "repeat") == 0) { config.KEY ## _repeat = true; } else _KEY_CONFIG_EXTRA(KEY)
 
 #define _KEY_CONFIG_EXTRA_MS_W_REPEAT(KEY) \
-    if (strcmp(co.value, "mouse_slow") == 0) { config.KEY = 0; config.mouse_slow_button = (GBTN_ ## KEY); } else _KEY_CONFIG_EXTRA_W_REPEAT(KEY)
+    if (strcmp(co.value, "mouse_slow") == 0) { config.KEY = 0; config.mouse_slow_button = (GBTN_ ## KEY); } \
+    else if (strcmp(co.value, "gyro_ratchet") == 0) { config.KEY = 0; config.gyro_ratchet_button = (GBTN_ ## KEY); } else _KEY_CONFIG_EXTRA_W_REPEAT(KEY)
 
 #define _KEY_CONFIG(KEY) \
     (strcmp(co.key, #KEY) == 0) { _KEY_CONFIG_EXTRA(KEY) }
@@ -106,6 +129,17 @@ std::vector<config_option> parseConfigFile(const char* path)
         } else { _KEY_CONFIG_EXTRA_W_REPEAT(KEY) } \
     }
 
+#define _KEY_CONFIG_MMS(KEY, KEY_BASE) \
+    (strcmp(co.key, #KEY) == 0) { \
+        if (strcmp(co.value, "mouse_movement_up") == 0) { \
+            config.KEY_BASE ## _as_mouse = true; \
+        } else if (strcmp(co.value, "mouse_wheel") == 0) { \
+            config.KEY_BASE ## _as_scroll = true; \
+        } else if (strcmp(co.value, "mouse_absolute") == 0) { \
+            config.KEY_BASE ## _as_absolute = true; \
+        } else { _KEY_CONFIG_EXTRA_W_REPEAT(KEY) } \
+    }
+
 #define _KEY_CONFIG_HK(KEY) \
     _KEY_CONFIG_MS_RPT(KEY) else if _KEY_CONFIG(KEY ## _hk)
 
@@ -119,52 +153,132 @@ std::vector<config_option> parseConfigFile(const char* path)
     (strcmp(co.key, #KEY) == 0)
 
 
-void readConfigFile(const char* config_file)
+// "4way" or "8way" stick keys, anything else is each axis on its own
+static int analogWays(const char* value)
 {
-    const auto parsedConfig = parseConfigFile(config_file);
-    for (const auto& co : parsedConfig) {
-        if _KEY_CONFIG_RPT(back)            // Back/Select button
-        else if _KEY_CONFIG_RPT(guide)      // Guide button
-        else if _KEY_CONFIG_RPT(start)      // Start button
-        else if _KEY_CONFIG_HK(a)           // A button, Hotkey + A
-        else if _KEY_CONFIG_HK(b)           // B button, Hotkey + B
-        else if _KEY_CONFIG_HK(x)           // X button, Hotkey + A
-        else if _KEY_CONFIG_HK(y)           // Y button, Hotkey + Y
-        else if _KEY_CONFIG_HK(l1)          // L1 button, Hotkey + L1
-        else if _KEY_CONFIG_HK(l2)          // L1 button, Hotkey + L2
-        else if _KEY_CONFIG_RPT(l3)         // L3 button
-        else if _KEY_CONFIG_HK(r1)          // R1 button, Hotkey + R1
-        else if _KEY_CONFIG_HK(r2)          // R2 button, Hotkey + R2
-        else if _KEY_CONFIG_RPT(r3)         // R3 button
-        else if _KEY_CONFIG_MM(up, dpad)    // Up dpad
-        else if _KEY_CONFIG_RPT(down)       // Down dpad
-        else if _KEY_CONFIG_RPT(left)       // Left dpad
-        else if _KEY_CONFIG_RPT(right)      // Right dpad
-        else if _KEY_CONFIG_MM(left_analog_up, left_analog)
-        else if _KEY_CONFIG_RPT(left_analog_down)
-        else if _KEY_CONFIG_RPT(left_analog_left)
-        else if _KEY_CONFIG_RPT(left_analog_right)
-        else if _KEY_CONFIG_MM(right_analog_up, right_analog)
-        else if _KEY_CONFIG_RPT(right_analog_down)
-        else if _KEY_CONFIG_RPT(right_analog_left)
-        else if _KEY_CONFIG_RPT(right_analog_right)
-        // Various settings
-        else if _KEY_CONFIG_SPECIAL(deadzone_mode) { config.deadzone_mode = deadzone_get_mode(co.value); }
-        else if _KEY_CONFIG_ATOI(deadzone)
-        else if _KEY_CONFIG_ATOI(deadzone_scale)
-        // An alias for fake_mouse_delay
-        else if _KEY2_CONFIG_ATOI(deadzone_delay, fake_mouse_delay)
-
-        else if _KEY_CONFIG_ATOI(deadzone_y)
-        else if _KEY_CONFIG_ATOI(deadzone_x)
-        else if _KEY_CONFIG_ATOI(deadzone_triggers)
-        else if _KEY_CONFIG_ATOI(dpad_mouse_step)
-        else if _KEY_CONFIG_ATOI(mouse_slow_scale)
-        else if _KEY2_CONFIG_ATOI(mouse_scale, fake_mouse_scale)
-        else if _KEY2_CONFIG_ATOI(mouse_delay, fake_mouse_delay)
-        else if _KEY2_CONFIG_ATOI(repeat_delay, key_repeat_delay)
-        else if _KEY2_CONFIG_ATOI(repeat_interval, key_repeat_interval)
+    if (strcmp(value, "4way") == 0)
+        return 4;
+    if (strcmp(value, "8way") == 0)
+        return 8;
+    return 0;
+}
+
+static bool applying_modifiers = false;
+
+bool applyConfigOption(const config_option& co)
+{
+    // add_alt and friends may come before the key they modify, so they wait for finishConfig
+    if (configModifier(co.value) != 0 && !applying_modifiers) {
+        config.added_modifiers.push_back(co);
+        return true;
+    }
+
+    if _KEY_CONFIG_RPT(back)            // Back/Select button
+    else if _KEY_CONFIG_RPT(guide)      // Guide button
+    else if _KEY_CONFIG_RPT(start)      // Start button
+    else if _KEY_CONFIG_HK(a)           // A button, Hotkey + A
+    else if _KEY_CONFIG_HK(b)           // B button, Hotkey + B
+    else if _KEY_CONFIG_HK(x)           // X button, Hotkey + A
+    else if _KEY_CONFIG_HK(y)           // Y button, Hotkey + Y
+    else if _KEY_CONFIG_HK(l1)          // L1 button, Hotkey + L1
+    else if _KEY_CONFIG_HK(l2)          // L1 button, Hotkey + L2
+    else if _KEY_CONFIG_MS_RPT(l3)      // L3 button
+    else if _KEY_CONFIG_HK(r1)          // R1 button, Hotkey + R1
+    else if _KEY_CONFIG_HK(r2)          // R2 button, Hotkey + R2
+    else if _KEY_CONFIG_MS_RPT(r3)      // R3 button
+    else if _KEY_CONFIG_MM(up, dpad)    // Up dpad
+    else if _KEY_CONFIG_RPT(down)       // Down dpad
+    else if _KEY_CONFIG_RPT(left)       // Left dpad
+    else if _KEY_CONFIG_RPT(right)      // Right dpad
+    else if _KEY_CONFIG_MMS(left_analog_up, left_analog)
+    else if _KEY_CONFIG_RPT(left_analog_down)
+    else if _KEY_CONFIG_RPT(left_analog_left)
+    else if _KEY_CONFIG_RPT(left_analog_right)
+    else if _KEY_CONFIG_MMS(right_analog_up, right_analog)
+    else if _KEY_CONFIG_RPT(right_analog_down)
+    else if _KEY_CONFIG_RPT(right_analog_left)
+    else if _KEY_CONFIG_RPT(right_analog_right)
+    // Various settings
+    else if _KEY_CONFIG_SPECIAL(deadzone_mode) { config.deadzone_mode = deadzone_get_mode(co.value); }
+    else if _KEY_CONFIG_ATOI(deadzone)
+    else if _KEY_CONFIG_ATOI(deadzone_scale)
+    // An alias for fake_mouse_delay
+    else if _KEY2_CONFIG_ATOI(deadzone_delay, fake_mouse_delay)
+
+    else if _KEY_CONFIG_ATOI(deadzone_y)
+    else if _KEY_CONFIG_ATOI(deadzone_x)
+    else if _KEY_CONFIG_ATOI(deadzone_triggers)
+    else if _KEY_CONFIG_ATOI(left_analog_press)
+    else if _KEY_CONFIG_ATOI(left_analog_release)
+    else if _KEY_CONFIG_ATOI(right_analog_press)
+    else if _KEY_CONFIG_ATOI(right_analog_release)
+    else if _KEY_CONFIG_SPECIAL(analog_press) { config.left_analog_press = config.right_analog_press = atoi(co.value); }
+    else if _KEY_CONFIG_SPECIAL(analog_release) { config.left_analog_release = config.right_analog_release = atoi(co.value); }
+    else if _KEY_CONFIG_ATOI(left_analog_min_hold)
+    else if _KEY_CONFIG_ATOI(right_analog_min_hold)
+    else if _KEY_CONFIG_SPECIAL(left_analog_keys) { config.left_analog_ways = analogWays(co.value); }
+    else if _KEY_CONFIG_SPECIAL(right_analog_keys) { config.right_analog_ways = analogWays(co.value); }
+    else if _KEY_CONFIG_SPECIAL(analog_keys) { config.left_analog_ways = config.right_analog_ways = analogWays(co.value); }
+    else if _KEY_CONFIG_ATOI(analog_diagonal)
+    else if _KEY_CONFIG_ATOI(left_analog_pulse)
+    else if _KEY_CONFIG_ATOI(right_analog_pulse)
+    else if _KEY_CONFIG_SPECIAL(analog_pulse) { config.left_analog_pulse = config.right_analog_pulse = atoi(co.value); }
+    else if _KEY_CONFIG_ATOI(analog_pulse_min)
+    else if _KEY_CONFIG_ATOI(analog_overlap)
+    else if _KEY_CONFIG_SPECIAL(analog_min_hold) { config.left_analog_min_hold = config.right_analog_min_hold = atoi(co.value); }
+    else if _KEY_CONFIG_ATOI(dpad_mouse_step)
+    else if _KEY_CONFIG_ATOI(mouse_slow_scale)
+    else if _KEY2_CONFIG_ATOI(mouse_scale, fake_mouse_scale)
+    else if _KEY2_CONFIG_ATOI(mouse_delay, fake_mouse_delay)
+    else if _KEY_CONFIG_ATOI(wheel_scale)
+    else if _KEY_CONFIG_ATOI(absolute_width)
+    else if _KEY_CONFIG_ATOI(absolute_height)
+    else if _KEY_CONFIG_SPECIAL(absolute_mode) { config.absolute_window = (strcmp(co.value, "window") == 0); }
+    else if _KEY_CONFIG_ATOI(absolute_radius)
+    else if _KEY_CONFIG_SPECIAL(absolute_recenter) { config.absolute_recenter = (strcmp(co.value, "false") != 0 && strcmp(co.value, "0") != 0); }
+    else if _KEY2_CONFIG_ATOI(repeat_delay, key_repeat_delay)
+    else if _KEY2_CONFIG_ATOI(repeat_interval, key_repeat_interval)
+    else if _KEY_CONFIG_SPECIAL(gyro) { config.gyro_mouse = (strcmp(co.value, "mouse") == 0); }
+    else if _KEY_CONFIG_ATOI(gyro_scale_x)
+    else if _KEY_CONFIG_ATOI(gyro_scale_y)
+    else if _KEY_CONFIG_SPECIAL(gyro_scale) { config.gyro_scale_x = config.gyro_scale_y = atoi(co.value); }
+    else if _KEY_CONFIG_ATOI(gyro_deadband)
+    else if _KEY_CONFIG_ATOI(gyro_smoothing)
+    else if _KEY_CONFIG_SPECIAL(touchpad) {
+        config.touchpad_mouse = (strcmp(co.value, "mouse") == 0);
+        config.touchpad_absolute = (strcmp(co.value, "absolute") == 0);
+    }
+    else if _KEY_CONFIG_ATOI(touchpad_scale_x)
+    else if _KEY_CONFIG_ATOI(touchpad_scale_y)
+    else if _KEY_CONFIG_SPECIAL(touchpad_scale) { config.touchpad_scale_x = config.touchpad_scale_y = atoi(co.value); }
+    else if _KEY_CONFIG_ATOI(touchpad_accel)
+    else if _KEY_CONFIG_ATOI(touchpad_scroll)
+    else if _KEY_CONFIG_ATOI(touchpad_tap_delay)
+    else if _KEY_CONFIG_SPECIAL(touchpad_tap) { config.touchpad_tap = char_to_keycode(co.value); }
+    else if _KEY_CONFIG_SPECIAL(touchpad_tap2) { config.touchpad_tap2 = char_to_keycode(co.value); }
+    else if _KEY_CONFIG_ATOI(text_input_delay)
+    else if _KEY_CONFIG_ATOI(macro_delay)
+    else if _KEY_CONFIG_ATOI(tap_hold_delay)
+    else if (strchr(co.key, '+') != NULL) { addConfigChord(co.key, co.value); } // button chords
+    else if _KEY_CONFIG_ATOI(kill_timeout)
+    else if _KEY_CONFIG_ATOI(drain_delay)
+    else if _KEY_CONFIG_ATOI(metrics_interval)
+    else {
+        return false;
     }
+    return true;
+}
+
+// Settings that depend on more than one option, once they have all been applied
+void finishConfig()
+{
+    // applied again after every change, which is harmless as adding a modifier twice does nothing
+    applying_modifiers = true;
+    for (const auto& co : config.added_modifiers) {
+        if (!applyConfigOption(co))
+            printf("ignoring %s = %s\n", co.key, co.value);
+    }
+    applying_modifiers = false;
 
     // Gotta clear these
     if (config.dpad_as_mouse) {
@@ -183,4 +297,45 @@ void readConfigFile(const char* config_file)
 
     if (config.mouse_slow_scale <= 0)
         config.mouse_slow_scale = 1;
+
+    if (config.analog_diagonal < 0)
+        config.analog_diagonal = 0;
+    if (config.analog_diagonal > 90)
+        config.analog_diagonal = 90;
+    if (config.analog_pulse_min < 0)
+        config.analog_pulse_min = 0;
+    if (config.analog_pulse_min > 100)
+        config.analog_pulse_min = 100;
+    if (config.analog_overlap < 0)
+        config.analog_overlap = 0;
+    if (config.analog_overlap > 22) // any more and it would reach past the next direction
+        config.analog_overlap = 22;
+
+    if (config.gyro_deadband < 0)
+        config.gyro_deadband = 0;
+
+    if (config.absolute_width < 2)
+        config.absolute_width = 2;
+    if (config.absolute_height < 2)
+        config.absolute_height = 2;
+
+    if (config.left_analog_as_absolute && config.right_analog_as_absolute) {
+        printf("only one stick can be mouse_absolute, using the left one\n");
+        config.right_analog_as_absolute = false; // there's only the one pointer
+    }
+    if (config.left_analog_as_absolute || config.right_analog_as_absolute || config.touchpad_absolute)
+        openAbsolutePointerDevice();
+
+    compileConfigMacros();
+    buildChordTable();
+    updateGyroSensor();
+}
+
+void readConfigFile(const char* config_file)
+{
+    const auto parsedConfig = parseConfigFile(config_file);
+    for (const auto& co : parsedConfig) {
+        applyConfigOption(co);
+    }
+    finishConfig();
 }
@@ -0,0 +1,295 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+#include "gptokeyb.h"
+
+#include <ctype.h>
+#include <list>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// Runtime control over a unix domain socket, one command per line:
+//
+//   load <config file>      reload the profile from a .gptk file
+//   set <option> <value>    change a single config option, e.g. "set a f5" or "set a = tap:tab hold:f5"
+//   text start [text]       send the text preset, or the given text
+//   text stop               stop sending text that is still queued
+//   held                    list the key codes currently held on the virtual device
+//   stats                   dump some statistics
+//   metrics                 dump the metrics in Prometheus text format
+//   attach<TAB>...          daemon mode: take over this game's options, see daemon.cpp
+//
+// Every reply ends with a line that is either "OK" or "ERR <reason>".
+
+#define CONTROL_MAX_LINE 1024
+#define CONTROL_MAX_CLIENTS 8
+
+struct control_client
+{
+    int fd;
+    int watch_id;
+    std::string buffer;
+};
+
+static int control_fd = -1;
+static std::string control_path;
+static std::list<control_client> control_clients;
+static std::string control_text; // keeps text set over the socket alive for config.text_input_preset
+static Uint32 control_start_tick = 0;
+
+static void controlReply(int fd, const std::string& reply)
+{
+    send(fd, reply.data(), reply.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
+static void reloadProfile(const char* path)
+{
+    GptokeybConfig fresh;
+    fresh.text_input_preset = config.text_input_preset; // these come from the environment or command line
+    fresh.kill_timeout = config.kill_timeout;
+    fresh.metrics_interval = config.metrics_interval;
+
+    resetInput();
+    config = fresh;
+    config_mode = true;
+    readConfigFile(path);
+    setMetricsLabels(path, NULL);
+    printf("Using ConfigFile %s\n", path);
+}
+
+static std::string runControlCommand(int fd, const std::string& line)
+{
+    std::istringstream input(line);
+    std::string command;
+    input >> command;
+
+    if (command == "attach") {
+        return attachDaemonSession(fd, line.substr(command.size()));
+
+    } else if (command == "load") {
+        std::string path;
+        std::getline(input >> std::ws, path);
+        if (xbox360_mode || daemonIdle())
+            return "ERR not in keyboard mode\n";
+        if (path.empty() || access(path.c_str(), R_OK) != 0)
+            return "ERR cannot read " + path + "\n";
+        reloadProfile(path.c_str());
+        return "OK\n";
+
+    } else if (command == "set") {
+        config_option co;
+        std::string key, value;
+        input >> key;
+        std::getline(input >> std::ws, value);
+        if (value.size() > 2 && value[0] == '=' && isspace((unsigned char)value[1]))
+            value.erase(0, value.find_first_not_of(" \t", 1)); // "set a = f5" as well as "set a f5"
+        if (key.empty() || value.empty() || key.size() >= CONFIG_ARG_MAX_BYTES || value.size() >= CONFIG_ARG_MAX_BYTES)
+            return "ERR usage: set <option> <value>\n";
+
+        strcpy(co.key, key.c_str());
+        strcpy(co.value, value.c_str());
+        resetInput(); // release what the old binding or mode is holding, nothing else would
+        if (!applyConfigOption(co))
+            return "ERR unknown option " + key + "\n";
+        finishConfig();
+        return "OK\n";
+
+    } else if (command == "text") {
+        std::string action, text;
+        input >> action;
+        std::getline(input >> std::ws, text);
+        if (xbox360_mode)
+            return "ERR not in keyboard mode\n";
+
+        if (action == "start") {
+            if (!text.empty()) {
+                control_text = text;
+                config.text_input_preset = &control_text[0];
+            }
+            if (config.text_input_preset == NULL)
+                return "ERR no text preset\n";
+            clearKeyFrames(STREAM_TEXT_PRESET);
+            processKeys();
+            return "OK\n";
+        } else if (action == "stop") {
+            clearKeyFrames(STREAM_TEXT_PRESET);
+            return "OK\n";
+        }
+        return "ERR usage: text start [text] | text stop\n";
+
+    } else if (command == "held") {
+        std::string reply = "held";
+        for (int code : heldKeys())
+            reply += " " + std::to_string(code);
+        return reply + "\nOK\n";
+
+    } else if (command == "stats") {
+        std::string reply;
+        reply += "uptime_ms " + std::to_string(SDL_GetTicks() - control_start_tick) + "\n";
+        reply += "held_keys " + std::to_string(heldKeys().size()) + "\n";
+        reply += "text_pending " + std::to_string(keyFramesPending(STREAM_TEXT_PRESET) ? 1 : 0) + "\n";
+        reply += "child_pid " + std::to_string(child_running ? (int)child_pid : 0) + "\n";
+        return reply + "OK\n";
+
+    } else if (command == "metrics") {
+        return formatMetrics() + "OK\n";
+    }
+
+    return "ERR unknown command " + command + "\n";
+}
+
+static bool controlClientCallback(int fd, void* param)
+{
+    control_client* client = static_cast<control_client*>(param);
+    char buffer[256];
+
+    ssize_t len = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (len < 0 && (errno == EAGAIN || errno == EINTR))
+        return true;
+
+    if (len > 0) {
+        client->buffer.append(buffer, len);
+
+        size_t end;
+        while ((end = client->buffer.find('\n')) != std::string::npos) {
+            std::string line = client->buffer.substr(0, end);
+            client->buffer.erase(0, end + 1);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (!line.empty())
+                controlReply(fd, runControlCommand(fd, line));
+        }
+
+        if (client->buffer.size() <= CONTROL_MAX_LINE)
+            return true;
+    }
+
+    // closed, failed, or sent a line that is far too long
+    closeControlClient(fd);
+    return false;
+}
+
+void closeControlClient(int fd)
+{
+    for (auto it = control_clients.begin(); it != control_clients.end(); ++it) {
+        if (it->fd == fd) {
+            removeLoopWatch(it->watch_id);
+            control_clients.erase(it);
+            close(fd);
+            daemonClientClosed(fd);
+            return;
+        }
+    }
+}
+
+static bool controlAcceptCallback(int fd, void*)
+{
+    int client_fd = accept4(fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (client_fd < 0)
+        return true;
+
+    if (control_clients.size() >= CONTROL_MAX_CLIENTS) {
+        controlReply(client_fd, "ERR too many clients\n");
+        close(client_fd);
+        return true;
+    }
+
+    control_clients.emplace_back();
+    control_clients.back().fd = client_fd;
+    control_clients.back().watch_id = addLoopWatch(client_fd, controlClientCallback, &control_clients.back());
+    return true;
+}
+
+bool openControlSocket(const char* path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (path == NULL || path[0] == '\0') {
+        mkdir("/run/gptokeyb", 0755);
+        control_path = "/run/gptokeyb/" + std::to_string(getpid()) + ".sock";
+    } else {
+        control_path = path;
+    }
+    if (control_path.size() >= sizeof(addr.sun_path)) {
+        printf("Control socket path is too long: %s\n", control_path.c_str());
+        return false;
+    }
+    strcpy(addr.sun_path, control_path.c_str());
+
+    control_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (control_fd < 0) {
+        printf("Unable to create control socket: %s\n", strerror(errno));
+        return false;
+    }
+
+    // a socket left behind by an instance that didn't exit cleanly can go, anything else is a mistake
+    struct stat st;
+    if (lstat(control_path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            printf("Not replacing %s, it isn't a socket\n", control_path.c_str());
+            close(control_fd);
+            control_fd = -1;
+            return false;
+        }
+        unlink(control_path.c_str());
+    }
+    if (bind(control_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(control_fd, CONTROL_MAX_CLIENTS) < 0) {
+        printf("Unable to listen on %s: %s\n", control_path.c_str(), strerror(errno));
+        close(control_fd);
+        control_fd = -1;
+        return false;
+    }
+
+    control_start_tick = SDL_GetTicks();
+    addLoopWatch(control_fd, controlAcceptCallback, NULL);
+    printf("Listening for commands on %s\n", control_path.c_str());
+    return true;
+}
+
+void closeControlSocket()
+{
+    if (control_fd < 0)
+        return;
+
+    close(control_fd);
+    unlink(control_path.c_str());
+    control_fd = -1;
+}
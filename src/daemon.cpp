@@ -0,0 +1,317 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb.h"
+
+#include <limits.h>
+#include <map>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// Daemon mode (-daemon): gptokeyb stays running between games with SDL, the controller DB and
+// both the keyboard/mouse and the xbox360 devices ready, and sends nothing until a game is
+// attached. Starting gptokeyb the usual way, e.g. `gptokeyb -c foo.gptk -k game`, then finds
+// the daemon's socket and only hands over its options and environment:
+//
+//   attach<TAB>NAME=value<TAB>...<TAB>--<TAB>arg<TAB>arg...
+//
+// The game stays attached for as long as that connection is open, so launch scripts that kill
+// gptokeyb when the game exits detach it as before, and the kill hotkey ends the client. The
+// daemon itself runs as gptokeyb-daemon so that killing gptokeyb by name leaves it alone.
+// Switching between keyboard and xbox360 mode only swaps which device events go to.
+
+#define DAEMON_SOCKET "/run/gptokeyb/daemon.sock"
+#define DAEMON_PROCESS_NAME "gptokeyb-daemon"
+
+static const char* session_environment[] = {
+    "HOTKEY", "EMUELEC", "TEXTINPUTPRESET", "TEXTINPUTINTERACTIVE", "PCKILLMODE",
+    "TEXTINPUTNOAUTOCAPITALS", "TEXTINPUTADDEXTRASYMBOLS", NULL,
+};
+
+static int session_fd = -1; // the client connection the attached game came from
+static bool device_xbox360 = false; // what uinp_fd is, spare_fd is the other one
+static std::vector<std::string> session_args; // the globals point into these while attached
+static std::map<std::string, std::string> session_env;
+
+// Re-executes us with DAEMON_PROCESS_NAME as argv[0] and sets the same name for the thread, so
+// ps, killall and pidof all see the daemon under its own name
+void nameDaemonProcess(char* argv[])
+{
+    if (strcmp(argv[0], DAEMON_PROCESS_NAME) != 0) {
+        argv[0] = const_cast<char*>(DAEMON_PROCESS_NAME);
+        execv("/proc/self/exe", argv);
+        printf("Unable to run as %s: %s\n", DAEMON_PROCESS_NAME, strerror(errno)); // carry on as we are
+    }
+    prctl(PR_SET_NAME, DAEMON_PROCESS_NAME);
+}
+
+static const char* daemonSocketPath()
+{
+    const char* path = SDL_getenv("GPTOKEYB_DAEMON");
+    return (path != NULL && path[0] != '\0') ? path : DAEMON_SOCKET;
+}
+
+// Client side: DAEMON_NOT_RUNNING means there is nobody to hand over to, or something in our
+// options only a gptokeyb of our own can do, like starting the game with --.
+int runDaemonClient(int argc, char* argv[])
+{
+    const char* config_file = "";
+    std::string line = "attach";
+
+    for (const char** name = session_environment; *name != NULL; name++) {
+        if (const char* value = SDL_getenv(*name))
+            line += std::string("\t") + *name + "=" + value;
+    }
+    line += "\t--";
+
+    for (int ii = 1; ii < argc; ii++) {
+        int used = parseSessionOption(argc, argv, ii, config_file);
+        if (used == 0)
+            return DAEMON_NOT_RUNNING;
+
+        for (int jj = ii; jj < ii + used; jj++) {
+            std::string arg = argv[jj];
+            char full_path[PATH_MAX];
+            if (jj > ii && strcmp(argv[ii], "-c") == 0 && realpath(argv[jj], full_path) != NULL)
+                arg = full_path; // the daemon has its own working directory
+            line += "\t" + arg;
+        }
+        ii += used - 1;
+    }
+    if (line.find_first_of("\n\r") != std::string::npos)
+        return DAEMON_NOT_RUNNING;
+    line += "\n";
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    const char* path = daemonSocketPath();
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return DAEMON_NOT_RUNNING;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return DAEMON_NOT_RUNNING;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return DAEMON_NOT_RUNNING;
+    }
+
+    std::string reply;
+    char buffer[256];
+    send(fd, line.data(), line.size(), MSG_NOSIGNAL);
+    while (reply.find('\n') == std::string::npos) {
+        ssize_t len = recv(fd, buffer, sizeof(buffer), 0);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0)
+            break;
+        reply.append(buffer, len);
+    }
+    if (reply.compare(0, 3, "OK\n") != 0) {
+        printf("gptokeyb daemon at %s refused us: %s", path, reply.empty() ? "no reply\n" : reply.c_str());
+        close(fd);
+        return DAEMON_NOT_RUNNING;
+    }
+    printf("Attached to the gptokeyb daemon at %s\n", path);
+    fflush(stdout);
+
+    // attached until either side goes away
+    while (true) {
+        ssize_t len = recv(fd, buffer, sizeof(buffer), 0);
+        if (len == 0 || (len < 0 && errno != EINTR))
+            break;
+    }
+    close(fd);
+    return 0;
+}
+
+static char* sessionEnvironment(const char* name)
+{
+    auto it = session_env.find(name);
+    return it != session_env.end() ? &it->second[0] : NULL;
+}
+
+static void selectDevice(bool xbox360)
+{
+    if (xbox360 != device_xbox360 && spare_fd >= 0) {
+        std::swap(uinp_fd, spare_fd);
+        device_xbox360 = xbox360;
+    }
+}
+
+// Back to sending nothing, with everything the last game held let go
+static void resetSession()
+{
+    GptokeybConfig fresh;
+    fresh.metrics_interval = config.metrics_interval;
+
+    resetInput();
+    config = fresh;
+    config_mode = false;
+    kill_mode = false;
+    sudo_kill = false;
+    pckill_mode = false;
+    app_exult_adjust = false;
+    hotkey_override = false;
+    emuelec_override = false;
+    textinputpreset_mode = false;
+    textinputinteractive_mode = false;
+    textinputinteractive_noautocapitals = false;
+    textinputinteractive_extrasymbols = false;
+    hotkey_code = NULL;
+    AppToKill = NULL;
+    xbox360_mode = false;
+    selectDevice(false);
+    finishConfig();
+}
+
+std::string attachDaemonSession(int fd, const std::string& args)
+{
+    if (!daemon_mode)
+        return "ERR not a daemon\n";
+
+    // a newer game takes over from whatever was attached before
+    if (session_fd >= 0 && session_fd != fd)
+        closeControlClient(session_fd);
+    resetSession();
+    session_fd = -1;
+
+    session_args.clear();
+    session_env.clear();
+    session_args.push_back("gptokeyb");
+    std::istringstream input(args);
+    std::string token;
+    bool in_env = true;
+    while (std::getline(input, token, '\t')) {
+        if (token.empty())
+            continue;
+        if (in_env && token == "--") {
+            in_env = false;
+        } else if (in_env) {
+            size_t equals = token.find('=');
+            if (equals != std::string::npos)
+                session_env[token.substr(0, equals)] = token.substr(equals + 1);
+        } else {
+            session_args.push_back(token);
+        }
+    }
+
+    std::vector<char*> argv;
+    for (auto& arg : session_args)
+        argv.push_back(&arg[0]);
+    int argc = (int)argv.size();
+
+    // the same steps as a gptokeyb of its own, without any of the setup it already has
+    const char* config_file = "/emuelec/configs/gptokeyb/default.gptk";
+    config_mode = true;
+    applySessionEnvironment(sessionEnvironment);
+    if (argc > 1) {
+        config_mode = false;
+        config_file = "";
+    }
+    for (int ii = 1; ii < argc; ii++) {
+        int used = parseSessionOption(argc, argv.data(), ii, config_file);
+        if (used == 0) {
+            resetSession();
+            return "ERR unsupported option " + session_args[ii] + "\n";
+        }
+        ii += used - 1;
+    }
+
+    selectDevice(xbox360_mode);
+    if (!xbox360_mode && config_mode) {
+        if (access(config_file, R_OK) != 0) {
+            resetSession();
+            return std::string("ERR cannot read ") + config_file + "\n";
+        }
+        printf("Using ConfigFile %s\n", config_file);
+        readConfigFile(config_file);
+    } else {
+        finishConfig(); // the chord table still needs the kill hotkey
+    }
+
+    setMetricsLabels(config_mode ? config_file : "", AppToKill != NULL ? AppToKill : "");
+    session_fd = fd;
+    printf("Attached %s in %s mode\n", AppToKill != NULL ? AppToKill : "a game", xbox360_mode ? "Xbox 360" : "keyboard");
+    return "OK\n";
+}
+
+void daemonClientClosed(int fd)
+{
+    if (fd != session_fd)
+        return;
+
+    session_fd = -1;
+    resetSession();
+    printf("Detached, waiting for the next game\n");
+}
+
+bool daemonAttached()
+{
+    return daemon_mode && session_fd >= 0;
+}
+
+// Controller input is dropped until a game is attached
+bool daemonIdle()
+{
+    return daemon_mode && session_fd < 0;
+}
+
+void detachDaemonSession()
+{
+    if (session_fd >= 0)
+        closeControlClient(session_fd);
+}
+
+bool openDaemonSocket(const char* path)
+{
+    device_xbox360 = xbox360_mode;
+    initialiseTextKeys();
+    initialiseCharacterSet();
+    resetSession();
+
+    if (path == NULL || path[0] == '\0')
+        path = daemonSocketPath();
+    if (strncmp(path, "/run/gptokeyb/", 14) == 0)
+        mkdir("/run/gptokeyb", 0755);
+    return openControlSocket(path);
+}
@@ -0,0 +1,263 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+// The game controller DB holds thousands of mappings and only one or two of them are ever needed,
+// so rather than have SDL parse the whole file on every launch we keep an index of where each
+// Linux mapping starts, keyed by GUID, next to a note of the file's size and mtime. Startup then
+// reads just the index and the lines for joysticks that are connected; a joystick plugged in later
+// gets its mapping looked up when SDL reports it. The index is rebuilt whenever the DB changes,
+// and if anything goes wrong we fall back to SDL_GameControllerAddMappingsFromFile.
+//
+// GUIDs are indexed with their CRC and version fields cleared, the same parts SDL ignores when
+// there's no exact match, and every line for that key is handed to SDL to choose from.
+
+#define DB_INDEX_MAGIC "GPTKDB1"
+#define DB_GUID_CHARS 32
+
+struct db_index_header
+{
+    char magic[8];
+    Uint64 mtime_ns;
+    Uint64 size;
+    Uint32 count;
+};
+
+struct db_index_entry
+{
+    char guid[DB_GUID_CHARS];
+    Uint32 offset;
+    Uint32 length;
+
+    bool operator<(const db_index_entry& other) const { return memcmp(guid, other.guid, DB_GUID_CHARS) < 0; }
+};
+
+static std::string db_path;
+static std::vector<db_index_entry> db_index;
+
+// Clear the CRC (bytes 2-3) and version (bytes 12-13) of a hex GUID
+static void normaliseGuid(char* guid)
+{
+    memset(guid + 4, '0', 4);
+    memset(guid + 24, '0', 4);
+    for (int ii = 0; ii < DB_GUID_CHARS; ii++)
+        guid[ii] = tolower((unsigned char)guid[ii]);
+}
+
+// mkdir -p, returns true if dir exists afterwards
+static bool makeDirs(const std::string& dir)
+{
+    for (size_t slash = dir.find('/', 1); slash != std::string::npos; slash = dir.find('/', slash + 1))
+        mkdir(dir.substr(0, slash).c_str(), 0755);
+    return (mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST);
+}
+
+static std::string indexPath(const char* db_file)
+{
+    std::string dir;
+    if (const char* cache = SDL_getenv("XDG_CACHE_HOME")) {
+        dir = std::string(cache) + "/gptokeyb";
+    } else if (const char* home = SDL_getenv("HOME")) {
+        dir = std::string(home) + "/.cache/gptokeyb";
+    } else {
+        dir = "/tmp/gptokeyb";
+    }
+    if (!makeDirs(dir)) {
+        dir = "/tmp/gptokeyb"; // no writable cache directory, building the index still works
+        makeDirs(dir);
+    }
+
+    char full_path[PATH_MAX];
+    if (realpath(db_file, full_path) == NULL)
+        snprintf(full_path, sizeof(full_path), "%s", db_file);
+
+    Uint32 hash = 2166136261u; // FNV-1a of the DB path, so each DB gets its own index
+    for (const char* ch = full_path; *ch != '\0'; ch++)
+        hash = (hash ^ (unsigned char)*ch) * 16777619u;
+
+    char name[32];
+    snprintf(name, sizeof(name), "/controllerdb-%08x.idx", hash);
+    return dir + name;
+}
+
+static bool readIndex(const std::string& path, const struct stat& db_stat)
+{
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == NULL)
+        return false;
+
+    db_index_header header;
+    bool valid = (fread(&header, sizeof(header), 1, fp) == 1
+        && memcmp(header.magic, DB_INDEX_MAGIC, sizeof(header.magic)) == 0
+        && header.mtime_ns == (Uint64)db_stat.st_mtim.tv_sec * 1000000000ULL + db_stat.st_mtim.tv_nsec
+        && header.size == (Uint64)db_stat.st_size);
+
+    if (valid) {
+        db_index.resize(header.count);
+        valid = (header.count == 0 || fread(db_index.data(), sizeof(db_index_entry), header.count, fp) == header.count);
+    }
+    fclose(fp);
+    return valid;
+}
+
+static bool buildIndex(const std::string& path, const struct stat& db_stat)
+{
+    FILE* fp = fopen(db_path.c_str(), "r");
+    if (fp == NULL)
+        return false;
+
+    char line[4096];
+    long offset = 0;
+    bool partial = false; // the previous read stopped short of the end of its line
+    db_index.clear();
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        size_t length = strlen(line);
+        long start = offset;
+        bool continued = partial;
+        offset += length;
+        partial = (line[length - 1] != '\n' && !feof(fp));
+
+        // only whole mapping lines for this platform, SDL would skip the others anyway
+        const char* platform = strstr(line, "platform:");
+        if (partial || continued)
+            continue;
+        if (length <= DB_GUID_CHARS || line[DB_GUID_CHARS] != ',' || line[0] == '#')
+            continue;
+        if (platform != NULL && strncmp(platform + 9, "Linux,", 6) != 0)
+            continue;
+
+        db_index_entry entry;
+        memcpy(entry.guid, line, DB_GUID_CHARS);
+        normaliseGuid(entry.guid);
+        entry.offset = (Uint32)start;
+        entry.length = (Uint32)length;
+        db_index.push_back(entry);
+    }
+    fclose(fp);
+
+    std::stable_sort(db_index.begin(), db_index.end()); // later lines still win in SDL
+
+    db_index_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DB_INDEX_MAGIC, sizeof(DB_INDEX_MAGIC));
+    header.mtime_ns = (Uint64)db_stat.st_mtim.tv_sec * 1000000000ULL + db_stat.st_mtim.tv_nsec;
+    header.size = (Uint64)db_stat.st_size;
+    header.count = (Uint32)db_index.size();
+
+    std::string temp = path + ".tmp";
+    fp = fopen(temp.c_str(), "wb");
+    if (fp != NULL) {
+        bool written = (fwrite(&header, sizeof(header), 1, fp) == 1
+            && fwrite(db_index.data(), sizeof(db_index_entry), db_index.size(), fp) == db_index.size());
+        if (fclose(fp) == 0 && written)
+            rename(temp.c_str(), path.c_str());
+        else
+            unlink(temp.c_str());
+    }
+    printf("indexed %zu controller mappings from %s\n", db_index.size(), db_path.c_str());
+    return true;
+}
+
+// Add every mapping for the joystick at device_index, returns how many were added
+int addControllerMapping(int device_index)
+{
+    if (db_index.empty())
+        return 0;
+
+    db_index_entry key;
+    char guid[DB_GUID_CHARS + 1];
+    SDL_JoystickGetGUIDString(SDL_JoystickGetDeviceGUID(device_index), guid, sizeof(guid));
+    memcpy(key.guid, guid, DB_GUID_CHARS);
+    normaliseGuid(key.guid);
+
+    auto range = std::equal_range(db_index.begin(), db_index.end(), key);
+    if (range.first == range.second)
+        return 0;
+
+    FILE* fp = fopen(db_path.c_str(), "r");
+    if (fp == NULL)
+        return 0;
+
+    int added = 0;
+    std::string mapping;
+    for (auto it = range.first; it != range.second; ++it) {
+        mapping.resize(it->length);
+        if (fseek(fp, it->offset, SEEK_SET) == 0 && fread(&mapping[0], 1, it->length, fp) == it->length) {
+            while (!mapping.empty() && (mapping.back() == '\n' || mapping.back() == '\r'))
+                mapping.pop_back();
+            if (SDL_GameControllerAddMapping(mapping.c_str()) >= 0)
+                added++;
+        }
+    }
+    fclose(fp);
+    return added;
+}
+
+void loadControllerDB(const char* db_file)
+{
+    struct stat db_stat;
+
+    db_path = db_file;
+    if (stat(db_file, &db_stat) != 0) {
+        printf("Unable to read %s: %s\n", db_file, strerror(errno));
+        return;
+    }
+
+    std::string path = indexPath(db_file);
+    if (!readIndex(path, db_stat) && !buildIndex(path, db_stat)) {
+        db_index.clear();
+        SDL_GameControllerAddMappingsFromFile(db_file);
+        return;
+    }
+
+    // the DB overrides SDL's built-in mappings, as it would when loaded whole
+    for (int ii = 0; ii < SDL_NumJoysticks(); ii++)
+        addControllerMapping(ii);
+}
+
+// A joystick was plugged in: give SDL its mapping from the DB
+void handleJoystickAdded(const SDL_Event& event)
+{
+    addControllerMapping(event.jdevice.which);
+}
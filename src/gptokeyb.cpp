@@ -38,6 +38,8 @@
 #include "gptokeyb.h"
 
 int uinp_fd = -1;
+int abs_fd = -1; // the absolute pointer device, only created when a profile uses it
+int spare_fd = -1; // daemon mode: the device for whichever of keyboard and xbox360 mode isn't in use
 uinput_user_dev uidev;
 
 bool kill_mode = false;
@@ -45,6 +47,7 @@ bool sudo_kill = false; //allow sudo kill instead of killall for non-emuelec sys
 bool pckill_mode = false; //emit alt+f4 to close apps on pc during kill mode, if env variable is set
 bool openbor_mode = false;
 bool xbox360_mode = false;
+bool daemon_mode = false; // stays running between games, see daemon.cpp
 bool textinputpreset_mode = false; 
 bool textinputinteractive_mode = false;
 bool textinputinteractive_noautocapitals = false;
@@ -59,6 +62,7 @@ char* hotkey_code;
 
 GptokeybConfig config;
 GptokeybState state;
+GptokeybMetrics metrics;
 
 int applyDeadzone(int value, int deadzone)
 {
@@ -70,59 +74,16 @@ int applyDeadzone(int value, int deadzone)
 }
 
 
-void processKeys()
-{
-    int lenText = strlen(config.text_input_preset);
-    char str[2];
-    char lowerstr[2];
-    char upperstr[2];
-    char lowerchar;
-    char upperchar;
-    bool uppercase = false;
-    for (int ii = 0; ii < lenText; ii++) {  
-        if (config.text_input_preset[ii] != '\0') {
-            memcpy( str, &config.text_input_preset[ii], 1 );        
-            str[1] = '\0';
-
-            lowerchar = std::tolower(config.text_input_preset[ii], std::locale());
-            upperchar = std::toupper(config.text_input_preset[ii], std::locale());
-
-            memcpy( upperstr, &upperchar, 1 );        
-            upperstr[1] = '\0';
-            memcpy( lowerstr, &lowerchar, 1 );        
-            lowerstr[1] = '\0';
-            uppercase = (strcmp(upperstr,str) == 0);
-
-            int code = char_to_keycode(lowerstr);
-
-            if (strcmp(str, " ") == 0) {
-                    code = KEY_SPACE;
-                    uppercase = false;
-            } else if (strcmp(str, "_") == 0) {
-                    code = KEY_MINUS;
-                    uppercase = true;
-            } else if (strcmp(str, "-") == 0) {
-                    code = KEY_MINUS;
-                    uppercase = true;
-            } else if (strcmp(str, ".") == 0) {
-                    code = KEY_DOT;
-                    uppercase = false;
-            } else if (strcmp(str, ",") == 0) {
-                    code = KEY_COMMA;
-                    uppercase = false;
-            }
-            
-            emitTextInputKey(code, uppercase);
-        } // if valid character
-    } //for
-}
-
 Uint32 repeatKeyCallback(Uint32 interval, void *param)
 {
         //timerCallback requires pointer parameter, but passing pointer to key_code for analog sticks doesn't work
         int key_code = *reinterpret_cast<int*>(param); 
+        metrics.repeat_ticks++;
+        TRACE(TRACE_TIMER, 0, key_code, 0);
+        TRACE_SPAN_BEGIN(TRACE_SPAN_KEY_REPEAT, key_code);
         emitKey(key_code, false);
         emitKey(key_code, true); 
+        TRACE_SPAN_END(TRACE_SPAN_KEY_REPEAT);
         interval = config.key_repeat_interval; // key repeats according to repeat interval; initial interval is set to delay
         return(interval);
 }
@@ -130,39 +91,43 @@ void setKeyRepeat(int code, bool is_pressed)
 {
     if (is_pressed) {
         state.key_to_repeat=code;
-        state.key_repeat_timer_id=SDL_AddTimer(config.key_repeat_delay, repeatKeyCallback, &state.key_to_repeat); // for a new repeat, use repeat delay for first time, then switch to repeat interval
+        state.key_repeat_timer_id=addLoopTimer(config.key_repeat_delay, repeatKeyCallback, &state.key_to_repeat); // for a new repeat, use repeat delay for first time, then switch to repeat interval
     } else {
-        SDL_RemoveTimer( state.key_repeat_timer_id );
+        removeLoopTimer(state.key_repeat_timer_id);
         state.key_repeat_timer_id=0;
         state.key_to_repeat=0;
     }
 }
 
-int main(int argc, char* argv[])
+// Whether anything wants the mouse moved or the wheel turned on the next mouse tick
+static bool mouseActive()
 {
-    const char* config_file = nullptr;
-
-    config_mode = true;
-    config_file = "/emuelec/configs/gptokeyb/default.gptk";
+    return (state.mouseX != 0 || state.mouseY != 0 || state.scrollX != 0 || state.scrollY != 0
+        || (config.dpad_as_mouse && GBTN_CHECK_BTN(DPAD)) || gyroMotionPending() || touchpadMotionPending());
+}
 
+// The environment and options that describe the game being played rather than this process,
+// shared with the sessions a daemon takes over the control socket
+void applySessionEnvironment(char* (*lookup)(const char* name))
+{
     // Add hotkey environment variable if available
-    if (char* env_hotkey = SDL_getenv("HOTKEY")) {
+    if (char* env_hotkey = lookup("HOTKEY")) {
         hotkey_override = true;
         hotkey_code = env_hotkey;
     }
     // Run in EmuELEC mode
-    if (SDL_getenv("EMUELEC")) {
+    if (lookup("EMUELEC")) {
         emuelec_override = true;
     }
 
     // Add textinput_preset environment variable if available
-    if (char* env_textinput = SDL_getenv("TEXTINPUTPRESET")) {
+    if (char* env_textinput = lookup("TEXTINPUTPRESET")) {
         textinputpreset_mode = true;
         config.text_input_preset = env_textinput;
     }
 
     // Add textinput_interactive environment variable if available
-    if (char* env_textinput_interactive = SDL_getenv("TEXTINPUTINTERACTIVE")) {
+    if (char* env_textinput_interactive = lookup("TEXTINPUTINTERACTIVE")) {
         if (strcmp(env_textinput_interactive,"Y") == 0) {
             textinputinteractive_mode = true;
             state.textinputinteractive_mode_active = false;
@@ -170,96 +135,209 @@ int main(int argc, char* argv[])
     }
 
     // Add pc alt+f4 exit environment variable if available
-    if (char* env_pckill_mode = SDL_getenv("PCKILLMODE")) {
+    if (char* env_pckill_mode = lookup("PCKILLMODE")) {
         if (strcmp(env_pckill_mode,"Y") == 0) {
             pckill_mode = true;
         }
     }
 
+    // extra options for textinput_interactive mode, they do nothing without it
+    if (char* env_textinput_nocaps = lookup("TEXTINPUTNOAUTOCAPITALS")) { // don't automatically use capitals for first letter or after space
+        if (strcmp(env_textinput_nocaps,"Y") == 0) {
+            textinputinteractive_noautocapitals = true;
+        }
+    }
+    if (char* env_textinput_extrasymbols = lookup("TEXTINPUTADDEXTRASYMBOLS")) { // extended characters set for interactive text input mode
+        if (strcmp(env_textinput_extrasymbols,"Y") == 0) {
+            textinputinteractive_extrasymbols = true;
+        }
+    }
+}
+
+// Returns how many arguments the option at argv[ii] took, or 0 if it isn't a session option
+int parseSessionOption(int argc, char* argv[], int ii, const char*& config_file)
+{
+    if (strcmp(argv[ii], "xbox360") == 0) {
+        xbox360_mode = true;
+    } else if (strcmp(argv[ii], "textinput") == 0) {
+        textinputinteractive_mode = true;
+        state.textinputinteractive_mode_active = false;
+    } else if (strcmp(argv[ii], "-c") == 0) {
+        config_mode = true;
+        if (ii + 1 < argc) { 
+            config_file = argv[ii + 1];
+            return 2;
+        }
+        config_file = "/emuelec/configs/gptokeyb/default.gptk";
+    } else if (strcmp(argv[ii], "-killtimeout") == 0) {
+        if (ii + 1 < argc) {
+            config.kill_timeout = atoi(argv[ii + 1]);
+            return 2;
+        }
+    } else if (strcmp(argv[ii], "-hotkey") == 0) {
+        if (ii + 1 < argc) {
+            hotkey_override = true;
+            hotkey_code = argv[ii + 1];
+            return 2;
+        }
+    } else if ((strcmp(argv[ii], "1") == 0) || (strcmp(argv[ii], "-1") == 0) || (strcmp(argv[ii], "-k") == 0)) {
+        if (ii + 1 < argc) { 
+            kill_mode = true;
+            AppToKill = argv[ii + 1];
+            return 2;
+        }
+    } else if ((strcmp(argv[ii], "-sudokill") == 0)) {
+        if (ii + 1 < argc) { 
+            kill_mode = true;
+            sudo_kill = true;
+            AppToKill = argv[ii + 1];
+            if (strcmp(AppToKill, "exult") == 0) { // special adjustment for Exult, which adds double spaces during text input
+                app_exult_adjust = true;
+            }
+            return 2;
+        }
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* config_file = nullptr;
+    char** child_argv = nullptr;
+    const char* control_path = nullptr;
+    const char* metrics_file = nullptr;
+    const char* record_file = nullptr;
+    const char* replay_file = nullptr;
+    int realtime_policy = -1;
+    int realtime_priority = 10;
+    int nice_value = -10;
+    bool set_nice = false;
+    const char* cpu_list = nullptr;
+    bool lock_memory = false;
+    bool background_mode = false;
+
+    startupMark();
+    config_mode = true;
+    config_file = "/emuelec/configs/gptokeyb/default.gptk";
+    applySessionEnvironment(SDL_getenv);
+
     if (argc > 1) {
         config_mode = false;
         config_file = "";
     }
 
+    // hand the game over to a running daemon instead, when it can take all of our options
+    int client_status = runDaemonClient(argc, argv);
+    if (client_status != DAEMON_NOT_RUNNING) {
+        return client_status;
+    }
+
     for( int ii = 1; ii < argc; ii++ )
     {      
-        if (strcmp(argv[ii], "xbox360") == 0) {
-            xbox360_mode = true;
-        } else if (strcmp(argv[ii], "textinput") == 0) {
-            textinputinteractive_mode = true;
-            state.textinputinteractive_mode_active = false;
-        } else if (strcmp(argv[ii], "-c") == 0) {
-            if (ii + 1 < argc) { 
-                config_mode = true;
-                config_file = argv[++ii];
+        if (int used = parseSessionOption(argc, argv, ii, config_file)) {
+            ii += used - 1;
+        } else if (strcmp(argv[ii], "-daemon") == 0 || strcmp(argv[ii], "--daemon") == 0) {
+            daemon_mode = true;
+        } else if (strcmp(argv[ii], "-control") == 0) {
+            if (ii + 1 < argc) {
+                control_path = argv[++ii];
             } else {
-                config_mode = true;
-                config_file = "/emuelec/configs/gptokeyb/default.gptk";
+                control_path = ""; // default path
             }
-        } else if (strcmp(argv[ii], "-hotkey") == 0) {
+        } else if (strcmp(argv[ii], "-metrics") == 0) {
             if (ii + 1 < argc) {
-                hotkey_override = true;
-                hotkey_code = argv[++ii];
+                metrics_file = argv[++ii];
             }
-        } else if ((strcmp(argv[ii], "1") == 0) || (strcmp(argv[ii], "-1") == 0) || (strcmp(argv[ii], "-k") == 0)) {
-            if (ii + 1 < argc) { 
-                kill_mode = true;
-                AppToKill = argv[++ii];
+        } else if (strcmp(argv[ii], "-record") == 0) {
+            if (ii + 1 < argc) {
+                record_file = argv[++ii];
             }
-        } else if ((strcmp(argv[ii], "-sudokill") == 0)) {
-            if (ii + 1 < argc) { 
-                kill_mode = true;
-                sudo_kill = true;
-                AppToKill = argv[++ii];
-                if (strcmp(AppToKill, "exult") == 0) { // special adjustment for Exult, which adds double spaces during text input
-                    app_exult_adjust = true;
+        } else if (strcmp(argv[ii], "-replay") == 0) {
+            if (ii + 1 < argc) {
+                replay_file = argv[++ii];
+            }
+#ifdef GPTOKEYB_TRACE
+        } else if (strcmp(argv[ii], "-trace") == 0) {
+            if (ii + 1 < argc) {
+                traceOpen(argv[++ii], TRACE_DEFAULT_RECORDS);
+            }
+#endif
+        } else if (strcmp(argv[ii], "-realtime") == 0) {
+            if (ii + 1 < argc) {
+                realtime_policy = realtimePolicy(argv[++ii]);
+                if (realtime_policy < 0) {
+                    printf("Unknown scheduling policy %s, use fifo or rr\n", argv[ii]);
                 }
             }
-            
-        } 
-    }
-
-    // Add textinput_interactive mode, check for extra options via environment variable if available
-    if (textinputinteractive_mode) {
-        if (char* env_textinput_nocaps = SDL_getenv("TEXTINPUTNOAUTOCAPITALS")) { // don't automatically use capitals for first letter or after space
-            if (strcmp(env_textinput_nocaps,"Y") == 0) {
-                textinputinteractive_noautocapitals = true;
+        } else if (strcmp(argv[ii], "-priority") == 0) {
+            if (ii + 1 < argc) {
+                realtime_priority = atoi(argv[++ii]);
             }
-        }
-        if (char* env_textinput_extrasymbols = SDL_getenv("TEXTINPUTADDEXTRASYMBOLS")) { // extended characters set for interactive text input mode
-            if (strcmp(env_textinput_extrasymbols,"Y") == 0) {
-                textinputinteractive_extrasymbols = true;
+        } else if (strcmp(argv[ii], "-nice") == 0) {
+            if (ii + 1 < argc) {
+                nice_value = atoi(argv[++ii]);
+                set_nice = true;
+            }
+        } else if (strcmp(argv[ii], "-cpu") == 0) {
+            if (ii + 1 < argc) {
+                cpu_list = argv[++ii];
+            }
+        } else if (strcmp(argv[ii], "-mlock") == 0) {
+            lock_memory = true;
+        } else if (strcmp(argv[ii], "-ready-fd") == 0 || strcmp(argv[ii], "--ready-fd") == 0) {
+            if (ii + 1 < argc) {
+                setReadyFd(atoi(argv[++ii]));
             }
-        }    
+        } else if (strcmp(argv[ii], "-ready-file") == 0 || strcmp(argv[ii], "--ready-file") == 0) {
+            if (ii + 1 < argc) {
+                setReadyFile(argv[++ii]);
+            }
+        } else if (strcmp(argv[ii], "-daemonize") == 0 || strcmp(argv[ii], "--daemonize") == 0) {
+            background_mode = true;
+        } else if (strcmp(argv[ii], "-standalone") == 0 || strcmp(argv[ii], "--standalone") == 0) {
+            // only stops us from handing over to a daemon
+        } else if (strcmp(argv[ii], "-profile-startup") == 0 || strcmp(argv[ii], "--profile-startup") == 0) {
+            startupProfile(true);
+        } else if (strcmp(argv[ii], "--") == 0) { // everything after this is the game to start and supervise
+            if (ii + 1 < argc) {
+                child_argv = &argv[ii + 1];
+            }
+            break;
+        }
+    }
+
+    if (daemon_mode) {
+        nameDaemonProcess(argv);
     }
+    if (background_mode && !daemonize()) {
+        return -1;
+    }
+    startupPhase("arguments");
 
+    // The device doesn't need SDL, so it is set up on its own thread while SDL starts
+    //if (!kill_mode) {  
+    bool create_device = config_mode || xbox360_mode || textinputinteractive_mode || daemon_mode; // initialise device, even in kill mode, now that kill mode will work with config & xbox modes
+    if (create_device && !startDeviceSetup()) {
+        return -1;
+    }
 
     // SDL initialization and main loop
     if (SDL_Init(SDL_INIT_GAMECONTROLLER | SDL_INIT_TIMER) != 0) {
         printf("SDL_Init() failed: %s\n", SDL_GetError());
         return -1;
     }
+    startupPhase("SDL_Init");
 
-    // Create fake input device (not needed in kill mode)
-    //if (!kill_mode) {  
-    if (config_mode || xbox360_mode || textinputinteractive_mode) { // initialise device, even in kill mode, now that kill mode will work with config & xbox modes
-        uinp_fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
-        if (uinp_fd < 0) {
-            printf("Unable to open /dev/uinput\n");
-            return -1;
-        }
-
-        // Intialize the uInput device to NULL
-        memset(&uidev, 0, sizeof(uidev));
-        uidev.id.version = 1;
-        uidev.id.bustype = BUS_USB;
-
+    if (daemon_mode) {
+        printf("Running as a daemon, waiting for games\n");
+    } else if (create_device) {
         if (xbox360_mode) {
             printf("Running in Fake Xbox 360 Mode\n");
-            setupFakeXbox360Device(uidev, uinp_fd);
         } else {
             printf("Running in Fake Keyboard mode\n");
-            setupFakeKeyboardMouseDevice(uidev, uinp_fd);
+            initialiseTextKeys();
 
             // if we are in config mode, read the file
             if (config_mode) {
@@ -286,31 +364,109 @@ int main(int argc, char* argv[])
                 printf("interactive text input mode includes extra symbols\n");
         
         }
-        // Create input device into input sub-system
-        write(uinp_fd, &uidev, sizeof(uidev));
+        startupPhase("config");
+    }
+
+    if (const char* db_file = SDL_getenv("SDL_GAMECONTROLLERCONFIG_FILE")) {
+        loadControllerDB(db_file);
+        startupPhase("controller DB");
+    }
 
-        if (ioctl(uinp_fd, UI_DEV_CREATE)) {
-            printf("Unable to create UINPUT device.");
+    if (create_device) {
+        if (!finishDeviceSetup()) {
             return -1;
         }
+        startupPhase("waiting for device");
+        if (xbox360_mode) {
+            startRumble(uinp_fd);
+        } else if (spare_fd >= 0) {
+            startRumble(spare_fd);
+        }
     }
 
-    if (const char* db_file = SDL_getenv("SDL_GAMECONTROLLERCONFIG_FILE")) {
-        SDL_GameControllerAddMappingsFromFile(db_file);
+    if (daemon_mode) {
+        if (!openDaemonSocket(control_path)) {
+            return -1;
+        }
+    } else if (control_path != nullptr) {
+        openControlSocket(control_path);
+    }
+
+    if (metrics_file != nullptr) {
+        setMetricsLabels(config_mode ? config_file : "", child_argv != nullptr ? child_argv[0] : AppToKill);
+        startMetricsExport(metrics_file);
+    }
+
+    notifyReady(); // waits for the device node to show up first
+    startupPhase("device node");
+
+    // Start the game ourselves now that the device exists, and quit when it does
+    if (child_argv != nullptr) {
+        if (!launchChild(child_argv)) {
+            return -1;
+        }
+        kill_mode = true;
+        startupPhase("starting the game");
+    }
+    buildChordTable(); // every mode is known by now
+
+    if (record_file != nullptr) {
+        startRecording(record_file);
+    }
+    if (replay_file != nullptr && !startReplay(replay_file)) {
+        return -1;
+    }
+
+    // only now, so the game we started doesn't inherit any of it
+    if (realtime_policy >= 0 || set_nice) {
+        setRealtimeScheduling(realtime_policy, realtime_priority, nice_value);
+    }
+    if (cpu_list != nullptr) {
+        setCpuAffinity(cpu_list);
+    }
+    if (lock_memory) {
+        lockMemory();
     }
+    startupPhase("everything else");
+    startupReport();
 
     SDL_Event event;
     bool running = true;
     int mouse_x = 0;
     int mouse_y = 0;
-    float slow_scale = (100.0 / (float)(config.mouse_slow_scale));
+    Uint32 mouse_tick = 0;
 
     while (running) {
-        if (state.mouseX != 0 || state.mouseY != 0 || (config.dpad_as_mouse && GBTN_CHECK_BTN(DPAD))) {
+        bool mouse_active = mouseActive();
+        int timeout = loopTimeout();
+
+        if (mouse_active) {
+            Sint32 mouse_timeout = (Sint32)(mouse_tick - SDL_GetTicks());
+            if (mouse_timeout < 0)
+                mouse_timeout = 0;
+            if (timeout < 0 || mouse_timeout < timeout)
+                timeout = mouse_timeout;
+        }
+
+        // wait for input, but only until the next mouse tick, timer or queued key frame is due
+        TRACE_SPAN_BEGIN(TRACE_SPAN_WAIT, timeout);
+        int got_event = SDL_WaitEventTimeout(&event, timeout);
+        TRACE_SPAN_END(TRACE_SPAN_WAIT);
+        if (got_event) {
+            running = handleInputEvent(event);
             while (running && SDL_PollEvent(&event)) {
                 running = handleInputEvent(event);
             }
+        } else if (timeout < 0) {
+            printf("SDL_WaitEvent() failed: %s\n", SDL_GetError());
+            return -1;
+        }
+
+        runLoopTimers();
 
+        mouse_active = mouseActive();
+        if (running && mouse_active && (Sint32)(mouse_tick - SDL_GetTicks()) <= 0) {
+            TRACE_SPAN_BEGIN(TRACE_SPAN_MOUSE_TICK, 0);
             mouse_x = state.mouseX;
             mouse_y = state.mouseY;
             if (config.dpad_as_mouse) {
@@ -321,32 +477,47 @@ int main(int argc, char* argv[])
             }
 
             if (config.mouse_slow_button && GBTN_CHECK(config.mouse_slow_button)) {
+                float slow_scale = (100.0 / (float)(config.mouse_slow_scale)); // the profile may be reloaded at runtime
                 mouse_x = (int)((float)(mouse_x) / slow_scale);
                 mouse_y = (int)((float)(mouse_y) / slow_scale);
             }
-
-            emitMouseMotion(mouse_x, mouse_y);
-            SDL_Delay(config.fake_mouse_delay);
-        } else {
-            if (!SDL_WaitEvent(&event)) {
-                printf("SDL_WaitEvent() failed: %s\n", SDL_GetError());
-                return -1;
-            }
-
-            running = handleInputEvent(event);
+            takeGyroMotion(mouse_x, mouse_y); // already scaled, and keeps its fractions for the next tick
+            int wheel = -state.scrollY * config.wheel_scale; // stick up scrolls up
+            int hwheel = state.scrollX * config.wheel_scale;
+            takeTouchpadMotion(mouse_x, mouse_y, wheel, hwheel);
+
+            emitMouseMotion(mouse_x, mouse_y, wheel, hwheel);
+            metrics.mouse_ticks++;
+            mouse_tick = SDL_GetTicks() + config.fake_mouse_delay;
+            TRACE_SPAN_END(TRACE_SPAN_MOUSE_TICK);
         }
     }
-    SDL_RemoveTimer( state.key_repeat_timer_id );
+    resetInput();
+    closeControlSocket();
+    removeReadyFile();
+    stopRecording();
+    writeMetricsFile();
+    if (child_running) {
+        stopChild(config.kill_timeout);
+    }
     SDL_Quit();
 
     /*
         * Give userspace some time to read the events before we destroy the
         * device with UI_DEV_DESTROY.
         */
-    sleep(1);
+    waitOutputDrained();
 
     /* Clean up */
     ioctl(uinp_fd, UI_DEV_DESTROY);
     close(uinp_fd);
-    return 0;
+    if (spare_fd >= 0) {
+        ioctl(spare_fd, UI_DEV_DESTROY);
+        close(spare_fd);
+    }
+    closeAbsolutePointerDevice();
+#ifdef GPTOKEYB_TRACE
+    traceClose();
+#endif
+    return child_status;
 }
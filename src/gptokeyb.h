@@ -51,6 +51,7 @@
 #include <fcntl.h>
 #include <sstream>
 #include <string.h>
+#include <string>
 #include <unistd.h>
 #include <vector>
 
@@ -60,41 +61,204 @@
 #define SDL_DEFAULT_REPEAT_DELAY 500
 #define SDL_DEFAULT_REPEAT_INTERVAL 30
 
+#ifndef REL_WHEEL_HI_RES // missing from kernel headers before 5.0
+#define REL_WHEEL_HI_RES 0x0b
+#define REL_HWHEEL_HI_RES 0x0c
+#endif
+
 #include "structs.h"
+#include "trace.h"
 
 DZ_MODE deadzone_get_mode(const char *str);
 void deadzone_calc(int &x, int &y, int in_x, int in_y);
+void deadzone_position(float &x, float &y, int in_x, int in_y);
+bool absolute_calc(int &x, int &y, int in_x, int in_y);
+int stick_angle(int x, int y);
+int stick_sector(int angle, int ways, int current);
+
+// chord.cpp
+uint buttonFromName(const char* name);
+uint hotkeyButtons();
+bool addConfigChord(const char* buttons, const char* value);
+void buildChordTable();
+bool chordButtonDown(uint button);
+CHORD_RELEASE chordButtonUp(uint button);
 
 // config.cpp
 std::vector<config_option> parseConfigFile(const char* path);
+bool applyConfigOption(const config_option& co);
+void finishConfig();
 void readConfigFile(const char* config_file);
 
+// control.cpp
+bool openControlSocket(const char* path);
+void closeControlClient(int fd);
+void closeControlSocket();
+
 // keyboard.cpp
 void initialiseCharacterSet();
 void nextTextInputKey(bool SingleIncrease);
 void prevTextInputKey(bool SingleIncrease);
+void startTextInputInteractive();
 
 void handleEventBtnInteractiveKeyboard(const SDL_Event &event, bool is_pressed);
 
 void setupFakeKeyboardMouseDevice(uinput_user_dev& device, int fd);
+bool openAbsolutePointerDevice();
+void closeAbsolutePointerDevice();
+uint buttonFromController(int button);
 void handleEventBtnFakeKeyboardMouseDevice(const SDL_Event &event, bool is_pressed);
 void handleEventAxisFakeKeyboardMouseDevice(const SDL_Event &event);
 
 
+// daemon.cpp
+#define DAEMON_NOT_RUNNING -1000 // from runDaemonClient() when we have to do the work ourselves
+void nameDaemonProcess(char* argv[]);
+int runDaemonClient(int argc, char* argv[]);
+bool openDaemonSocket(const char* path);
+std::string attachDaemonSession(int fd, const std::string& args);
+void daemonClientClosed(int fd);
+bool daemonAttached();
+bool daemonIdle();
+void detachDaemonSession();
+
+// dbcache.cpp
+int addControllerMapping(int device_index);
+void loadControllerDB(const char* db_file);
+void handleJoystickAdded(const SDL_Event& event);
+
+// gyro.cpp
+void setGyroRate(float rate);
+float gyroRate();
+void updateGyroSensor();
+void gyroControllerAdded(SDL_GameController* controller);
+void gyroControllerRemoved(SDL_GameController* controller);
+void addGyroSample(const float data[3], float dt);
+void handleGyroEvent(const SDL_Event& event);
+bool gyroMotionPending();
+void takeGyroMotion(int& x, int& y);
+
 // input.cpp
 bool handleInputEvent(const SDL_Event& event);
+void resetInput();
 
 // Xbox360.cpp
 void setupFakeXbox360Device(uinput_user_dev& device, int fd);
 void handleEventBtnFakeXbox360Device(const SDL_Event &event, bool is_pressed);
 void handleEventAxisFakeXbox360Device(const SDL_Event &event);
 
+// taphold.cpp
+short addConfigTapHold(const char* value);
+void tapHoldKey(int code, bool is_pressed);
+void tapHoldOtherPressed();
+short tapHoldTapCode(int code);
+void resetTapHolds();
+
+// textinput.cpp
+void initialiseTextKeys();
+void keyFrameAdd(key_frame& frame, short code, bool is_pressed);
+void buildTextInputFrames(std::vector<key_frame>& frames, const char* text, Uint32 delay);
+void processKeys();
+void queueTextInputKey(int code, bool uppercase);
+void queueTextInputReplace(int code, bool uppercase);
+
+// macro.cpp
+bool parseKeyChord(const char* text, std::vector<short>& keys);
+bool compileMacro(const char* text, Uint32 delay, std::vector<key_frame>& frames);
+short addConfigMacro(const char* text);
+short addConfigCombo(const std::vector<short>& keys);
+short configKeyCode(const char* value);
+short configModifier(const char* value);
+void addConfigModifier(short& code, short& modifier, short added);
+bool bindingKeys(short code, short modifier, std::vector<short>& keys);
+void emitCombo(int code, bool is_pressed);
+void compileConfigMacros();
+void playMacro(int code);
+void queueKeyTap(short code, short modifier, Uint32 hold, int tag = STREAM_MACRO);
+
+// metrics.cpp
+void countInputEvent(const SDL_Event& event, Uint64 start);
+void setMetricsLabels(const char* profile, const char* app);
+std::string formatMetrics();
+void startMetricsExport(const char* path);
+bool writeMetricsFile();
+
+// process.cpp
+int spawnProcess(const char* const argv[], bool wait);
+std::vector<pid_t> findProcesses(const char* name);
+void killProcesses(const char* name, bool use_sudo, Uint32 timeout);
+bool launchChild(char* const argv[]);
+void stopChild(Uint32 timeout);
+
+// realtime.cpp
+int realtimePolicy(const char* name);
+bool setRealtimeScheduling(int policy, int priority, int nice_value);
+bool setCpuAffinity(const char* cpus);
+bool lockMemory();
+
+// pulse.cpp
+void setAnalogPulse(int index, int value, int press, int release, Uint32 period, short key, short modifier);
+void resetPulses();
+
+// ready.cpp
+void setReadyFd(int fd);
+void setReadyFile(const char* path);
+bool daemonize();
+void notifyReady();
+void removeReadyFile();
+
+// replay.cpp
+bool startRecording(const char* path);
+void stopRecording();
+void recordInputEvent(const SDL_Event& event);
+bool startReplay(const char* path);
+
+// rumble.cpp
+void rumbleControllerAdded(SDL_GameController* controller);
+void rumbleControllerRemoved(SDL_GameController* controller);
+void handleRumbleEvent(int fd, const struct input_event& ev);
+void startRumble(int fd);
+
+// schedule.cpp
+typedef Uint32 (*LoopTimerCallback)(Uint32 interval, void* param);
+int addLoopTimer(Uint32 delay, LoopTimerCallback callback, void* param);
+void removeLoopTimer(int id);
+void queueKeyFrames(const std::vector<key_frame>& frames, int tag, bool collapsible);
+void clearKeyFrames(int tag);
+bool keyFramesPending(int tag);
+int loopTimeout();
+void runLoopTimers();
+typedef bool (*LoopWatchCallback)(int fd, void* param);
+int addLoopWatch(int fd, LoopWatchCallback callback, void* param);
+void removeLoopWatch(int id);
+bool handleLoopWatchEvent(const SDL_Event& event);
+
+// startup.cpp
+void startupProfile(bool enable);
+void startupMark();
+void startupPhase(const char* name);
+void startupReport();
+bool startDeviceSetup();
+bool finishDeviceSetup();
+
+// touchpad.cpp
+void handleTouchpadEvent(const SDL_Event& event);
+void resetTouchpad();
+bool touchpadMotionPending();
+void takeTouchpadMotion(int& x, int& y, int& wheel, int& hwheel);
+
 // util.cpp
 void emit(int type, int code, int val);
-void emitMouseMotion(int x, int y);
+void emitMouseMotion(int x, int y, int wheel = 0, int hwheel = 0);
 void emitAxisMotion(int code, int value);
-void emitTextInputKey(int code, bool uppercase);
+void emitAbsolutePointer(int x, int y);
 void emitKey(int code, bool is_pressed, int modifier = 0);
+void emitKeyFrame(const key_frame& frame);
+bool isKeyHeld(int code);
+std::vector<int> heldKeys();
+void emitReleaseAll();
+void waitOutputDrained();
+bool createUinputDevice(int fd, const uinput_user_dev& device);
 void handleAnalogTrigger(bool is_triggered, bool& was_triggered, int key, int modifier = 0);
 
 short char_to_keycode(const char* str);
@@ -102,15 +266,19 @@ short char_to_keycode(const char* str);
 void doKillMode();
 
 // gptokeyb.cpp
+void applySessionEnvironment(char* (*lookup)(const char* name));
+int parseSessionOption(int argc, char* argv[], int ii, const char*& config_file);
 int applyDeadzone(int value, int deadzone);
 void setKeyRepeat(int code, bool is_pressed);
-void processKeys();
 
 
 extern GptokeybConfig config;
 extern GptokeybState state;
+extern GptokeybMetrics metrics;
 
 extern int uinp_fd;
+extern int abs_fd;
+extern int spare_fd;
 extern uinput_user_dev uidev;
 
 extern bool kill_mode;
@@ -118,6 +286,7 @@ extern bool sudo_kill;      //allow sudo kill instead of killall for non-emuelec
 extern bool pckill_mode;    //emit alt+f4 to close apps on pc during kill mode, if env variable is set
 extern bool openbor_mode;
 extern bool xbox360_mode;
+extern bool daemon_mode;
 extern bool textinputpreset_mode; 
 extern bool textinputinteractive_mode;
 extern bool textinputinteractive_noautocapitals;
@@ -125,6 +294,9 @@ extern bool textinputinteractive_extrasymbols;
 extern bool app_exult_adjust;
 
 extern char* AppToKill;
+extern pid_t child_pid;
+extern bool child_running;
+extern int child_status;
 extern bool config_mode;
 extern bool hotkey_override;
 extern bool emuelec_override;
@@ -0,0 +1,168 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb.h"
+
+#include <math.h>
+
+// Gyro aiming, "gyro = mouse". The controller's gyro is read at whatever rate it reports at, each
+// sample is turned into pointer movement in floating point, and the main loop sends the whole
+// part of what has built up on its next mouse tick, carrying the fraction over to the next one.
+// Slow turns therefore still move the pointer, just not on every tick.
+//
+// Yaw moves the pointer left and right, pitch moves it up and down, gyro_scale_x/_y are pointer
+// units per degree turned. Holding the gyro_ratchet button ignores the gyro, so the controller
+// can be turned back without moving the pointer.
+
+#define GYRO_SMOOTHING_TIME 0.125f // seconds averaged over below the smoothing threshold
+#define GYRO_MAX_INTERVAL 0.05f    // longest gap between samples we trust, after a stall or hotplug
+
+static SDL_GameController* gyro_controller = NULL;
+static float gyro_interval = 0.0f; // seconds between samples, 0 if the rate isn't known
+static Uint32 gyro_last_timestamp = 0;
+
+void setGyroRate(float rate)
+{
+    gyro_interval = (rate > 0.0f ? 1.0f / rate : 0.0f);
+}
+
+float gyroRate()
+{
+    return (gyro_interval > 0.0f ? 1.0f / gyro_interval : 0.0f);
+}
+
+// Turn the sensor on or off to match the config, so it costs nothing when the profile doesn't use it
+void updateGyroSensor()
+{
+    if (gyro_controller == NULL || !SDL_GameControllerHasSensor(gyro_controller, SDL_SENSOR_GYRO))
+        return;
+
+    bool enable = config.gyro_mouse && !xbox360_mode;
+    if (SDL_GameControllerSetSensorEnabled(gyro_controller, SDL_SENSOR_GYRO, enable ? SDL_TRUE : SDL_FALSE) != 0) {
+        printf("Unable to enable the gyro: %s\n", SDL_GetError());
+        return;
+    }
+    if (enable) {
+        setGyroRate(SDL_GameControllerGetSensorDataRate(gyro_controller, SDL_SENSOR_GYRO));
+        printf("gyro enabled at %.0f Hz\n", gyroRate());
+    }
+}
+
+void gyroControllerAdded(SDL_GameController* controller)
+{
+    gyro_controller = controller;
+    updateGyroSensor();
+}
+
+void gyroControllerRemoved(SDL_GameController* controller)
+{
+    if (controller == gyro_controller)
+        gyro_controller = NULL;
+}
+
+// One gyro sample in radians per second, covering dt seconds
+void addGyroSample(const float data[3], float dt)
+{
+    if (config.gyro_ratchet_button && GBTN_CHECK(config.gyro_ratchet_button)) {
+        state.gyro_smooth_x = 0.0f;
+        state.gyro_smooth_y = 0.0f;
+        return;
+    }
+
+    float yaw = data[1] * (float)(180.0 / M_PI);
+    float pitch = data[0] * (float)(180.0 / M_PI);
+    float speed = sqrtf(yaw * yaw + pitch * pitch);
+
+    // the deadband is taken off the speed rather than cutting it, so there's no jump leaving it
+    if (speed <= (float)config.gyro_deadband)
+        return;
+    float deadband_scale = (speed - config.gyro_deadband) / speed;
+    yaw *= deadband_scale;
+    pitch *= deadband_scale;
+    speed -= config.gyro_deadband;
+
+    // Tiered smoothing: slow movements, mostly hand shake, are averaged; fast ones pass straight
+    // through so they don't lag. Between half the threshold and the threshold the two are blended.
+    if (config.gyro_smoothing > 0) {
+        float threshold = (float)config.gyro_smoothing;
+        float direct = (speed - threshold / 2) / (threshold / 2);
+        direct = (direct < 0.0f ? 0.0f : (direct > 1.0f ? 1.0f : direct));
+        float weight = dt / (GYRO_SMOOTHING_TIME + dt);
+
+        state.gyro_smooth_x += (yaw * (1.0f - direct) - state.gyro_smooth_x) * weight;
+        state.gyro_smooth_y += (pitch * (1.0f - direct) - state.gyro_smooth_y) * weight;
+        yaw = yaw * direct + state.gyro_smooth_x;
+        pitch = pitch * direct + state.gyro_smooth_y;
+    }
+
+    state.gyro_x -= yaw * dt * config.gyro_scale_x;
+    state.gyro_y -= pitch * dt * config.gyro_scale_y;
+}
+
+void handleGyroEvent(const SDL_Event& event)
+{
+    if (event.csensor.sensor != SDL_SENSOR_GYRO || !config.gyro_mouse || xbox360_mode || state.textinputinteractive_mode_active)
+        return;
+
+    // the sensor's own rate is steadier than SDL's millisecond timestamps
+    float dt = gyro_interval;
+    if (dt <= 0.0f) {
+        dt = (float)(event.csensor.timestamp - gyro_last_timestamp) / 1000.0f;
+        if (dt > GYRO_MAX_INTERVAL)
+            dt = GYRO_MAX_INTERVAL;
+    }
+    gyro_last_timestamp = event.csensor.timestamp;
+
+    addGyroSample(event.csensor.data, dt);
+}
+
+bool gyroMotionPending()
+{
+    return (fabsf(state.gyro_x) >= 1.0f || fabsf(state.gyro_y) >= 1.0f);
+}
+
+// Adds the whole pointer units built up since the last mouse tick, keeping the fractions
+void takeGyroMotion(int& x, int& y)
+{
+    int gyro_x = (int)state.gyro_x;
+    int gyro_y = (int)state.gyro_y;
+    state.gyro_x -= gyro_x;
+    state.gyro_y -= gyro_y;
+    x += gyro_x;
+    y += gyro_y;
+}
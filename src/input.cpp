@@ -37,14 +37,49 @@
 
 #include "gptokeyb.h"
 
-bool handleInputEvent(const SDL_Event& event)
+// Forget everything about the buttons and sticks that are held and release whatever we were
+// pressing on the virtual device because of them.
+void resetInput()
+{
+    removeLoopTimer(state.key_repeat_timer_id);
+    removeLoopTimer(state.analog_hold_timer_id);
+    resetTapHolds();
+    resetTouchpad();
+    resetPulses();
+    if (state.input_repeat_timer_id != 0) {
+        removeLoopTimer(state.input_repeat_timer_id);
+    }
+    clearKeyFrames(STREAM_TEXT_PRESET);
+    clearKeyFrames(STREAM_TEXT_INTERACTIVE);
+    clearKeyFrames(STREAM_MACRO);
+
+    state = GptokeybState();
+    emitReleaseAll();
+}
+
+static bool dispatchInputEvent(const SDL_Event& event)
 {
+    // a daemon with no game attached keeps the controllers open but sends nothing
+    if (daemonIdle()) {
+        switch (event.type) {
+        case SDL_CONTROLLERBUTTONDOWN:
+        case SDL_CONTROLLERBUTTONUP:
+        case SDL_CONTROLLERAXISMOTION:
+        case SDL_CONTROLLERTOUCHPADDOWN:
+        case SDL_CONTROLLERTOUCHPADMOTION:
+        case SDL_CONTROLLERTOUCHPADUP:
+        case SDL_CONTROLLERSENSORUPDATE:
+            return true;
+        }
+    }
+
     // Main input loop
     switch (event.type) {
     case SDL_CONTROLLERBUTTONDOWN:
     case SDL_CONTROLLERBUTTONUP:
         {
             const bool is_pressed = event.type == SDL_CONTROLLERBUTTONDOWN;
+            state.input_controller = event.cbutton.which;
 
             if (state.textinputinteractive_mode_active) {
                 handleEventBtnInteractiveKeyboard(event, is_pressed);
@@ -58,6 +93,7 @@ bool handleInputEvent(const SDL_Event& event)
         break;
 
     case SDL_CONTROLLERAXISMOTION:
+        state.input_controller = event.caxis.which;
         if (xbox360_mode) {
             handleEventAxisFakeXbox360Device(event);
         } else {
@@ -65,9 +101,26 @@ bool handleInputEvent(const SDL_Event& event)
         }
         break;
 
+    case SDL_CONTROLLERTOUCHPADDOWN:
+    case SDL_CONTROLLERTOUCHPADMOTION:
+    case SDL_CONTROLLERTOUCHPADUP:
+        state.input_controller = event.ctouchpad.which;
+        handleTouchpadEvent(event);
+        break;
+
+    case SDL_CONTROLLERSENSORUPDATE:
+        handleGyroEvent(event);
+        break;
+
+    case SDL_JOYDEVICEADDED:
+        handleJoystickAdded(event);
+        break;
+
     case SDL_CONTROLLERDEVICEADDED:
         if (xbox360_mode == true || config_mode == true) {
-            SDL_GameControllerOpen(0);
+            SDL_GameController* controller = SDL_GameControllerOpen(0);
+            gyroControllerAdded(controller);
+            rumbleControllerAdded(controller);
 
             // SDL_GameController* controller = SDL_GameControllerOpen(0);
             // if (controller) {
@@ -76,20 +129,50 @@ bool handleInputEvent(const SDL_Event& event)
             // }
 
         } else {
-            SDL_GameControllerOpen(event.cdevice.which);
+            SDL_GameController* controller = SDL_GameControllerOpen(event.cdevice.which);
+            gyroControllerAdded(controller);
+            rumbleControllerAdded(controller);
         }
         break;
 
     case SDL_CONTROLLERDEVICEREMOVED:
         if (SDL_GameController* controller = SDL_GameControllerFromInstanceID(event.cdevice.which)) {
+            gyroControllerRemoved(controller);
+            rumbleControllerRemoved(controller);
             SDL_GameControllerClose(controller);
         }
+        if (event.cdevice.which == state.input_controller)
+            resetInput(); // nothing can release what the controller was holding any more
         break;
 
     case SDL_QUIT:
         return false;
         break;
+
+    default:
+        handleLoopWatchEvent(event);
+        break;
     }
 
     return true;
 }
+
+bool handleInputEvent(const SDL_Event& event)
+{
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    if (event.type == SDL_CONTROLLERAXISMOTION) {
+        TRACE(TRACE_EVENT, event.type, event.caxis.axis, event.caxis.value);
+    } else if (event.type == SDL_CONTROLLERBUTTONDOWN || event.type == SDL_CONTROLLERBUTTONUP) {
+        TRACE(TRACE_EVENT, event.type, event.cbutton.button, event.cbutton.state);
+    } else {
+        TRACE(TRACE_EVENT, event.type, 0, 0);
+    }
+    TRACE_SPAN_BEGIN(TRACE_SPAN_INPUT, event.type);
+    bool running = dispatchInputEvent(event);
+    TRACE_SPAN_END(TRACE_SPAN_INPUT);
+
+    countInputEvent(event, start);
+    recordInputEvent(event);
+    return running;
+}
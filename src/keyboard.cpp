@@ -37,6 +37,8 @@
 
 #include "gptokeyb.h"
 
+#include <algorithm>
+
 const int maxKeysNoExtendedSymbols = 69;        //number of keys available for interactive text input
 const int maxKeysWithSymbols = 96;              //number of keys available for interactive text input with extra symbols
 int maxKeys = maxKeysNoExtendedSymbols;
@@ -264,7 +266,10 @@ void initialiseCharacterSet()
 Uint32 repeatInputCallback(Uint32 interval, void *param)
 {
     int key_code = *reinterpret_cast<int*>(param); 
-    if (key_code == KEY_UP) {
+    metrics.repeat_ticks++;
+    if (!state.textinputinteractive_mode_active) {
+        interval = 0; //mode was exited while the button was held
+    } else if (key_code == KEY_UP) {
         prevTextInputKey(true);
         interval = config.key_repeat_interval; // key repeats according to repeat interval
     } else if (key_code == KEY_DOWN) {
@@ -273,39 +278,47 @@ Uint32 repeatInputCallback(Uint32 interval, void *param)
     } else {
         interval = 0; //turn off timer if invalid keycode
     }
+    if (interval == 0)
+        state.input_repeat_timer_id = 0;
     return (interval);
 }
 
 void setInputRepeat(int code, bool is_pressed)
 {
+    if (state.input_repeat_timer_id != 0) {
+        removeLoopTimer(state.input_repeat_timer_id);
+        state.input_repeat_timer_id = 0;
+    }
     if (is_pressed) {
         state.key_to_repeat = code;
-        state.key_repeat_timer_id=SDL_AddTimer(config.key_repeat_interval, repeatInputCallback, &state.key_to_repeat); // for a new repeat, use repeat delay for first time, then switch to repeat interval
+        state.input_repeat_timer_id = addLoopTimer(config.key_repeat_interval, repeatInputCallback, &state.key_to_repeat); // runs on the main loop, so text output is never sent from the timer thread
     } else {
-        SDL_RemoveTimer( state.key_repeat_timer_id );
-        state.key_repeat_timer_id=0;
         state.key_to_repeat=0;
     }
 }
 
 void addTextInputCharacter()
 {
-    emitTextInputKey(character_set[current_key[current_character]],character_set_shift[current_key[current_character]]);
+    queueTextInputKey(character_set[current_key[current_character]],character_set_shift[current_key[current_character]]);
 }
 
 void removeTextInputCharacter()
 {
-    emitTextInputKey(KEY_BACKSPACE, false); //delete one character
+    queueTextInputKey(KEY_BACKSPACE, false); //delete one character
 }
 
 void confirmTextInputCharacter()
 {
-    emitTextInputKey(KEY_ENTER, false); //emit ENTER to confirm text input
+    queueTextInputKey(KEY_ENTER, false); //emit ENTER to confirm text input
+}
+
+void replaceTextInputCharacter()
+{
+    queueTextInputReplace(character_set[current_key[current_character]],character_set_shift[current_key[current_character]]);
 }
 
 void nextTextInputKey(bool SingleIncrease) // enable fast skipping if SingleIncrease = false
 {
-    removeTextInputCharacter(); //delete character(s)
     if (SingleIncrease) {
         current_key[current_character]++;
     } else {
@@ -317,12 +330,11 @@ void nextTextInputKey(bool SingleIncrease) // enable fast skipping if SingleIncr
         current_key[current_character]++; //skip space as first character 
     }
 
-    addTextInputCharacter(); //add new character
+    replaceTextInputCharacter(); //delete character and add new one
 }
 
 void prevTextInputKey(bool SingleDecrease)
 {
-    removeTextInputCharacter(); //delete character(s)
     if (SingleDecrease) {
         current_key[current_character]--;
     } else {
@@ -333,7 +345,7 @@ void prevTextInputKey(bool SingleDecrease)
     } else if ((current_character == 0) && (character_set[current_key[current_character]] == KEY_SPACE)) {
         current_key[current_character]--; //skip space as first character due to weird graphical issue with Exult
     }
-    addTextInputCharacter(); //add new character
+    replaceTextInputCharacter(); //delete character and add new one
 }
 
 void setupFakeKeyboardMouseDevice(uinput_user_dev& device, int fd)
@@ -354,12 +366,87 @@ void setupFakeKeyboardMouseDevice(uinput_user_dev& device, int fd)
     ioctl(fd, UI_SET_EVBIT, EV_REL);
     ioctl(fd, UI_SET_RELBIT, REL_X);
     ioctl(fd, UI_SET_RELBIT, REL_Y);
+    ioctl(fd, UI_SET_RELBIT, REL_WHEEL);
+    ioctl(fd, UI_SET_RELBIT, REL_HWHEEL);
+    ioctl(fd, UI_SET_RELBIT, REL_WHEEL_HI_RES);
+    ioctl(fd, UI_SET_RELBIT, REL_HWHEEL_HI_RES);
     ioctl(fd, UI_SET_KEYBIT, BTN_LEFT);
     ioctl(fd, UI_SET_KEYBIT, BTN_RIGHT);
 }
 
+static int abs_width = 0; // the range the absolute pointer device was created with
+static int abs_height = 0;
+
+// A second device for mouse_absolute, so the keyboard/mouse device stays a plain relative mouse.
+// Its range is config.absolute_width x absolute_height, so it is created again when they change.
+bool openAbsolutePointerDevice()
+{
+    uinput_user_dev device;
+
+    if (abs_fd >= 0 && abs_width == config.absolute_width && abs_height == config.absolute_height)
+        return true;
+    closeAbsolutePointerDevice();
+
+    abs_fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (abs_fd < 0) {
+        printf("Unable to open /dev/uinput for the absolute pointer\n");
+        return false;
+    }
+
+    memset(&device, 0, sizeof(device));
+    strncpy(device.name, "Fake Absolute Pointer", UINPUT_MAX_NAME_SIZE);
+    device.id.version = 1;
+    device.id.bustype = BUS_USB;
+    device.id.vendor = 0x1234;
+    device.id.product = 0x5679;
+    device.absmin[ABS_X] = 0;
+    device.absmax[ABS_X] = config.absolute_width - 1;
+    device.absmin[ABS_Y] = 0;
+    device.absmax[ABS_Y] = config.absolute_height - 1;
+
+    ioctl(abs_fd, UI_SET_EVBIT, EV_SYN);
+    ioctl(abs_fd, UI_SET_EVBIT, EV_ABS);
+    ioctl(abs_fd, UI_SET_ABSBIT, ABS_X);
+    ioctl(abs_fd, UI_SET_ABSBIT, ABS_Y);
+    ioctl(abs_fd, UI_SET_PROPBIT, INPUT_PROP_DIRECT);
+    // clicks still come from the keyboard/mouse device, this just marks it as a pointer
+    ioctl(abs_fd, UI_SET_EVBIT, EV_KEY);
+    ioctl(abs_fd, UI_SET_KEYBIT, BTN_LEFT);
+
+    if (!createUinputDevice(abs_fd, device)) {
+        printf("Unable to create the absolute pointer device\n");
+        close(abs_fd);
+        abs_fd = -1;
+        return false;
+    }
+
+    abs_width = config.absolute_width;
+    abs_height = config.absolute_height;
+    printf("absolute pointer device created, %dx%d\n", config.absolute_width, config.absolute_height);
+    return true;
+}
+
+void closeAbsolutePointerDevice()
+{
+    if (abs_fd < 0)
+        return;
+
+    ioctl(abs_fd, UI_DEV_DESTROY);
+    close(abs_fd);
+    abs_fd = -1;
+}
+
+static void emitButtonKey(uint button, bool is_pressed);
+
 void handleEventBtnInteractiveKeyboard(const SDL_Event &event, bool is_pressed)
 {
+    uint button = buttonFromController(event.cbutton.button);
+    if (!is_pressed && (state.button_state & button)) {
+        // held since before the mode started: let go of it without typing anything
+        if (chordButtonUp(button) == CHORD_RELEASE_KEY)
+            emitButtonKey(button, false);
+    }
+
     switch (event.cbutton.button) {
     case SDL_CONTROLLER_BUTTON_DPAD_LEFT: //move back one character
         if (is_pressed) {
@@ -463,316 +550,339 @@ void handleEventBtnInteractiveKeyboard(const SDL_Event &event, bool is_pressed)
     }   //switch (event.cbutton.button) for textinputinteractive_mode_active     
 }
 
-#define _UPDATE_BUTTON_STATE(BUTTON) \
-    if (is_pressed) { \
-        GBTN_ON(BUTTON); \
-    } else { \
-        GBTN_OFF(BUTTON); \
-    }
-
-#define _DPAD_TRIGGER(DIRECTION) \
-    _UPDATE_BUTTON_STATE(DIRECTION) \
-    emitKey(config.DIRECTION, is_pressed, config.left_modifier); \
-    if ((config.DIRECTION ## _repeat && is_pressed && (state.key_to_repeat == 0)) || \
-            (!(is_pressed) && (state.key_to_repeat == config.DIRECTION))) { \
-        setKeyRepeat(config.DIRECTION, is_pressed); \
-    }
-
-#define _BUTTON_TRIGGER(BUTTON) \
-    _UPDATE_BUTTON_STATE(BUTTON) \
-    if (state.hotkey_pressed) { \
-        emitKey(config.BUTTON ## _hk, is_pressed, config.BUTTON ## _hk_modifier); \
-        if (is_pressed) { \
-            state.BUTTON ## _hk_was_pressed = true; \
-            state.hotkey_combo_triggered = true; \
-        } else { \
-            state.BUTTON ## _hk_was_pressed = false; \
-        } \
-    } else if (state.BUTTON ## _hk_was_pressed && !(is_pressed)) { \
-        emitKey(config.BUTTON ## _hk, is_pressed, config.BUTTON ## _hk_modifier); \
-        state.BUTTON ## _hk_was_pressed = false; \
-    } else { \
-        emitKey(config.BUTTON, is_pressed, config.BUTTON ## _modifier); \
-        if ((config.BUTTON ## _repeat && is_pressed && (state.key_to_repeat == 0)) || \
-                (!(is_pressed) && (state.key_to_repeat == config.BUTTON))){ \
-            setKeyRepeat(config.BUTTON, is_pressed); \
-        } \
+struct button_binding
+{
+    short GptokeybConfig::*code;
+    short GptokeybConfig::*modifier;
+    bool GptokeybConfig::*repeat;
+};
+
+#define _BUTTON_BINDING(BUTTON) \
+    { &GptokeybConfig::BUTTON, &GptokeybConfig::BUTTON ## _modifier, &GptokeybConfig::BUTTON ## _repeat }
+
+// Indexed by GBTN bit number
+static const button_binding button_bindings[] = {
+    _BUTTON_BINDING(a),
+    _BUTTON_BINDING(b),
+    _BUTTON_BINDING(x),
+    _BUTTON_BINDING(y),
+    _BUTTON_BINDING(r1),
+    _BUTTON_BINDING(r2),
+    _BUTTON_BINDING(r3),
+    _BUTTON_BINDING(l1),
+    _BUTTON_BINDING(l2),
+    _BUTTON_BINDING(l3),
+    _BUTTON_BINDING(up),
+    _BUTTON_BINDING(down),
+    _BUTTON_BINDING(left),
+    _BUTTON_BINDING(right),
+    _BUTTON_BINDING(start),
+    _BUTTON_BINDING(back),
+    _BUTTON_BINDING(guide),
+};
+
+uint buttonFromController(int button)
+{
+    switch (button) {
+    case SDL_CONTROLLER_BUTTON_A:             return GBTN_A;
+    case SDL_CONTROLLER_BUTTON_B:             return GBTN_B;
+    case SDL_CONTROLLER_BUTTON_X:             return GBTN_X;
+    case SDL_CONTROLLER_BUTTON_Y:             return GBTN_Y;
+    case SDL_CONTROLLER_BUTTON_LEFTSHOULDER:  return GBTN_L1;
+    case SDL_CONTROLLER_BUTTON_RIGHTSHOULDER: return GBTN_R1;
+    case SDL_CONTROLLER_BUTTON_LEFTSTICK:     return GBTN_L3;
+    case SDL_CONTROLLER_BUTTON_RIGHTSTICK:    return GBTN_R3;
+    case SDL_CONTROLLER_BUTTON_DPAD_UP:       return GBTN_UP;
+    case SDL_CONTROLLER_BUTTON_DPAD_DOWN:     return GBTN_DOWN;
+    case SDL_CONTROLLER_BUTTON_DPAD_LEFT:     return GBTN_LEFT;
+    case SDL_CONTROLLER_BUTTON_DPAD_RIGHT:    return GBTN_RIGHT;
+    case SDL_CONTROLLER_BUTTON_START:         return GBTN_START;
+    case SDL_CONTROLLER_BUTTON_BACK:          return GBTN_BACK;
+    case SDL_CONTROLLER_BUTTON_GUIDE:         return GBTN_GUIDE;
     }
+    return GBTN_NONE;
+}
 
-void handleEventBtnFakeKeyboardMouseDevice(const SDL_Event& event, bool is_pressed)
+static void emitButtonKey(uint button, bool is_pressed)
 {
-    //config mode (i.e. not textinputinteractive_mode_active)
-    switch (event.cbutton.button) {
-    case SDL_CONTROLLER_BUTTON_DPAD_LEFT:
-        if (textinputpreset_mode) { //check if input preset mode is triggered
-            state.textinputpresettrigger_jsdevice = event.cdevice.which;
-            state.textinputpresettrigger_pressed = is_pressed;
-            if (state.start_pressed && state.textinputpresettrigger_pressed)
-                break; //hotkey combo triggered
-        }
-        _DPAD_TRIGGER(left)
-        break;
+    const button_binding& binding = button_bindings[__builtin_ctz(button)];
+    short code = config.*binding.code;
+
+    emitKey(code, is_pressed, config.*binding.modifier);
+    if (code >= TAPHOLD_CODE_BASE)
+        return; // tap/hold buttons don't repeat
+    if ((config.*binding.repeat && is_pressed && (state.key_to_repeat == 0)) || (!(is_pressed) && (state.key_to_repeat == code))) {
+        setKeyRepeat(code, is_pressed);
+    }
+}
 
-    case SDL_CONTROLLER_BUTTON_DPAD_UP:
-        _DPAD_TRIGGER(up)
-        break;
+// Button presses and releases (including L2/R2 crossing deadzone_triggers) go through the chord
+// engine first, which decides whether the button's own key is sent.
+static void handleButton(uint button, bool is_pressed)
+{
+    if (button == GBTN_NONE)
+        return;
 
-    case SDL_CONTROLLER_BUTTON_DPAD_RIGHT:
-        if (textinputpreset_mode) { //check if input preset enter_press is triggered
-            state.textinputconfirmtrigger_jsdevice = event.cdevice.which;
-            state.textinputconfirmtrigger_pressed = is_pressed;
-            if (state.start_pressed && state.textinputconfirmtrigger_pressed)
-                break; //hotkey combo triggered
-        }
-        _DPAD_TRIGGER(right)
-        break;
+    if (is_pressed) {
+        tapHoldOtherPressed();
+        if (!chordButtonDown(button))
+            emitButtonKey(button, true);
+        return;
+    }
 
-    case SDL_CONTROLLER_BUTTON_DPAD_DOWN:
-        if (textinputinteractive_mode) {
-            state.textinputinteractivetrigger_jsdevice = event.cdevice.which;
-            state.textinputinteractivetrigger_pressed = is_pressed;
-            if (state.start_pressed && state.textinputinteractivetrigger_pressed)
-                break; //hotkey combo triggered
-        }
-        _DPAD_TRIGGER(down)
+    switch (chordButtonUp(button)) {
+    case CHORD_RELEASE_KEY:
+        emitButtonKey(button, false);
         break;
 
-    case SDL_CONTROLLER_BUTTON_A:
-        _BUTTON_TRIGGER(a)
+    case CHORD_RELEASE_TAP: // held back in case it started a chord, so it never repeats
+        queueKeyTap(config.*button_bindings[__builtin_ctz(button)].code, config.*button_bindings[__builtin_ctz(button)].modifier, 16);
         break;
 
-    case SDL_CONTROLLER_BUTTON_B:
-        _BUTTON_TRIGGER(b)
+    case CHORD_RELEASE_NONE:
         break;
+    }
+}
 
-    case SDL_CONTROLLER_BUTTON_X:
-        _BUTTON_TRIGGER(x)
-        break;
+void handleEventBtnFakeKeyboardMouseDevice(const SDL_Event& event, bool is_pressed)
+{
+    //config mode (i.e. not textinputinteractive_mode_active)
+    handleButton(buttonFromController(event.cbutton.button), is_pressed);
+}
 
-    case SDL_CONTROLLER_BUTTON_Y:
-        _BUTTON_TRIGGER(y)
-        break;
+void startTextInputInteractive()
+{
+    printf("text input interactive mode active\n");
+    state.textinputinteractive_mode_active = true;
+    removeLoopTimer(state.key_repeat_timer_id); // disable any active key repeat timer
+    current_character = 0;
 
-    case SDL_CONTROLLER_BUTTON_LEFTSHOULDER:
-        _BUTTON_TRIGGER(l1)
-        break;
+    addTextInputCharacter();
+}
 
-    case SDL_CONTROLLER_BUTTON_RIGHTSHOULDER:
-        _BUTTON_TRIGGER(r1)
-        break;
+static void scheduleAnalogHold(Uint32 wait);
 
-    case SDL_CONTROLLER_BUTTON_LEFTSTICK:
-        _UPDATE_BUTTON_STATE(l3)
-        if ((kill_mode && hotkey_override && (strcmp(hotkey_code, "l3") == 0)) || (textinputpreset_mode && hotkey_override && (strcmp(hotkey_code, "l3") == 0)) || (textinputinteractive_mode && hotkey_override && (strcmp(hotkey_code, "l3") == 0))) {
-            state.hotkey_jsdevice = event.cdevice.which;
-            state.hotkey_pressed = is_pressed;
-        } else if (hotkey_override && (strcmp(hotkey_code, "l3") == 0)) {
-            state.hotkey_jsdevice = event.cdevice.which;
-            state.hotkey_pressed = is_pressed;            
-        }
-        if (state.hotkey_pressed && (state.hotkey_jsdevice == event.cdevice.which)) {
-            state.hotkey_was_pressed = true; // if hotkey is pressed, note the details of hotkey press in case it is released without triggering a hotkey combo event, since its press will need to be processed
-
-        } else if (state.hotkey_combo_triggered && !(is_pressed)) { 
-            state.hotkey_combo_triggered = false; //hotkey combo was pressed; ignore hotkey button release
-            state.hotkey_was_pressed = false; //reset hotkey
-        } else if (state.hotkey_was_pressed && !(is_pressed)) { 
-            state.hotkey_was_pressed = false;
-            emitKey(config.l3, true, config.l3_modifier); //key pressed and now released without hotkey trigger so process key press then key release
-            SDL_Delay(16);
-            emitKey(config.l3, is_pressed, config.l3_modifier);            
-            if ((config.l3_repeat && is_pressed && (state.key_to_repeat == 0)) || (!(is_pressed) && (state.key_to_repeat == config.l3))){
-                setKeyRepeat(config.l3, is_pressed);
-                //note: hotkey cannot be assigned for key repeat; release key repeat for completeness
-            }
-        } //hotkey state check prior to emitting key, to avoid conflicts with emitkey and hotkey press        
-        else {
-            emitKey(config.l3, is_pressed, config.l3_modifier);            
-            if ((config.l3_repeat && is_pressed && (state.key_to_repeat == 0)) || (!(is_pressed) && (state.key_to_repeat == config.l3))){
-                setKeyRepeat(config.l3, is_pressed);
-            }
+// One direction of a stick acting as a key. It is pressed once the stick goes past the press
+// threshold, and only let go once the stick is back inside the release threshold and the key
+// has been down for min_hold, so a stick resting near the edge doesn't chatter.
+static void analogDirectionKey(int value, int press, int release, Uint32 min_hold, bool& was_pressed, Uint32& since,
+    short key, short modifier, bool repeat)
+{
+    if (!was_pressed) {
+        if (value <= press)
+            return;
+
+        handleAnalogTrigger(true, was_pressed, key, modifier);
+        since = SDL_GetTicks();
+        if (repeat && state.key_to_repeat == 0) {
+            setKeyRepeat(key, true);
         }
-        break;
+    } else {
+        if (value >= release)
+            return;
 
-    case SDL_CONTROLLER_BUTTON_RIGHTSTICK:
-        _UPDATE_BUTTON_STATE(r3)
-        emitKey(config.r3, is_pressed, config.r3_modifier);
-        if ((config.r3_repeat && is_pressed && (state.key_to_repeat == 0)) || (!(is_pressed) && (state.key_to_repeat == config.r3))){
-            setKeyRepeat(config.r3, is_pressed);
+        Uint32 held = SDL_GetTicks() - since;
+        if (held < min_hold) {
+            scheduleAnalogHold(min_hold - held);
+            return;
         }
-        break;
 
-    case SDL_CONTROLLER_BUTTON_GUIDE:
-        _UPDATE_BUTTON_STATE(guide)
-        if ((kill_mode && !(hotkey_override)) || (kill_mode && hotkey_override && (strcmp(hotkey_code, "guide") == 0)) || (textinputpreset_mode && !(hotkey_override)) || (textinputpreset_mode && (strcmp(hotkey_code, "guide") == 0)) || (textinputinteractive_mode && !(hotkey_override)) || (textinputinteractive_mode && (strcmp(hotkey_code, "guide") == 0))) {
-            state.hotkey_jsdevice = event.cdevice.which;
-            state.hotkey_pressed = is_pressed;
-        } else if (!(hotkey_override)) {
-            state.hotkey_jsdevice = event.cdevice.which;
-            state.hotkey_pressed = is_pressed;
+        handleAnalogTrigger(false, was_pressed, key, modifier);
+        if (repeat && state.key_to_repeat == key) {
+            setKeyRepeat(key, false);
         }
-        if (state.hotkey_pressed && (state.hotkey_jsdevice == event.cdevice.which)) {
-            state.hotkey_was_pressed = true; // if hotkey is pressed, note the details of hotkey press in case it is released without triggering a hotkey combo event, since its press will need to be processed
-
-        } else if (state.hotkey_combo_triggered && !(is_pressed)) { 
-            state.hotkey_combo_triggered = false; //hotkey combo was pressed; ignore hotkey button release
-            state.hotkey_was_pressed = false; //reset hotkey
-
-        } else if (state.hotkey_was_pressed && !(is_pressed)) { 
-            state.hotkey_was_pressed = false;
-            emitKey(config.guide, true, config.guide_modifier); //key pressed and now released without hotkey trigger so process key press then key release
-            SDL_Delay(16);
-            emitKey(config.guide, is_pressed, config.guide_modifier);
-            if ((config.guide_repeat && is_pressed && (state.key_to_repeat == 0)) || (!(is_pressed) && (state.key_to_repeat == config.guide))){
-                setKeyRepeat(config.guide, is_pressed);
-                //note: hotkey cannot be assigned for key repeat; release key repeat for completeness
-            }
-        } //hotkey state check prior to emitting key, to avoid conflicts with emitkey and hotkey press        
-        else {
-            emitKey(config.guide, is_pressed, config.guide_modifier);
-            if ((config.guide_repeat && is_pressed && (state.key_to_repeat == 0)) || (!(is_pressed) && (state.key_to_repeat == config.guide))){
-                setKeyRepeat(config.guide, is_pressed);
-            }
-        }
-        break;
+    }
+}
 
-    case SDL_CONTROLLER_BUTTON_BACK: // aka select
-        _UPDATE_BUTTON_STATE(back)
-        if (!emuelec_override) {
-            if ((kill_mode && !(hotkey_override)) || (kill_mode && hotkey_override && (strcmp(hotkey_code, "back") == 0))) {
-                state.hotkey_jsdevice = event.cdevice.which;
-                state.hotkey_pressed = is_pressed;
-            } else if (!(hotkey_override)) {
-                state.hotkey_jsdevice = event.cdevice.which;
-                state.hotkey_pressed = is_pressed;
-            }
-        }
+// deadzone unless the profile sets its own, and a release threshold no further out than the press one
+static void analogThresholds(int press_option, int release_option, int& press, int& release)
+{
+    press = press_option > 0 ? press_option : config.deadzone;
+    release = (release_option > 0 && release_option < press) ? release_option : press;
+}
 
-        if (state.hotkey_pressed && (state.hotkey_jsdevice == event.cdevice.which)) {
-            state.hotkey_was_pressed = true; // if hotkey is pressed, note the details of hotkey press in case it is released without triggering a hotkey combo event, since its press will need to be processed
-
-        } else if (state.hotkey_combo_triggered && !(is_pressed)) { 
-            state.hotkey_combo_triggered = false; //hotkey combo was pressed; ignore hotkey button release
-            state.hotkey_was_pressed = false; //reset hotkey
-
-        } else if (state.hotkey_was_pressed && !(is_pressed)) { 
-            state.hotkey_was_pressed = false;
-            emitKey(config.back, true, config.back_modifier); //key pressed and now released without hotkey trigger so process key press then key release
-            SDL_Delay(16);
-            emitKey(config.back, is_pressed, config.back_modifier);
-            if ((config.back_repeat && is_pressed && (state.key_to_repeat == 0)) || (!(is_pressed) && (state.key_to_repeat == config.back))){
-                setKeyRepeat(config.back, is_pressed);
-                //note: hotkey cannot be assigned for key repeat; release key repeat for completeness
-            }
-        } //hotkey state check prior to emitting key, to avoid conflicts with emitkey and hotkey press        
-        else {
-            emitKey(config.back, is_pressed, config.back_modifier);
-            if ((config.back_repeat && is_pressed && (state.key_to_repeat == 0)) || (!(is_pressed) && (state.key_to_repeat == config.back))){
-                setKeyRepeat(config.back, is_pressed);
-            }
-        }
-        break;
+// The direction keys each sector presses: up, down, left, right
+static const bool sector_directions[8][4] = {
+    {false, false, false, true},  // right
+    {true,  false, false, true},  // up-right
+    {true,  false, false, false}, // up
+    {true,  false, true,  false}, // up-left
+    {false, false, true,  false}, // left
+    {false, true,  true,  false}, // down-left
+    {false, true,  false, false}, // down
+    {false, true,  false, true},  // down-right
+};
+
+// Adds a key to a frame that may need more than one write, if every direction has a lot of keys
+static void sectorFrameAdd(key_frame& frame, short code, bool is_pressed)
+{
+    if (std::find(frame.code, frame.code + frame.count, code) != frame.code + frame.count)
+        return;
+    if (frame.count == KEY_FRAME_MAX) {
+        emitKeyFrame(frame);
+        frame.count = 0;
+    }
+    keyFrameAdd(frame, code, is_pressed);
+}
 
-    case SDL_CONTROLLER_BUTTON_START:
-        _UPDATE_BUTTON_STATE(start)
-        if ((kill_mode) || (textinputpreset_mode) || (textinputinteractive_mode)) {
-            state.start_jsdevice = event.cdevice.which;
-            state.start_pressed = is_pressed;
-        } // start pressed - ready for text input modes if trigger is also pressed
-        if (state.start_pressed && (state.start_jsdevice == event.cdevice.which)) { 
-            state.start_was_pressed = true; // if start as hotkey is pressed, note the details of start key press in case it is released without triggering a hotkey event, since its press will need to be processed
-
-        } else if (state.start_combo_triggered && !(is_pressed)) { 
-            state.start_combo_triggered = false; //ignore start key release if it acted as hotkey
-            state.start_was_pressed = false; //reset hotkey
-
-        } else if (state.start_was_pressed && !(is_pressed)) { //key pressed and now released without start trigger so process original key press, pause, then process key release
-            state.start_was_pressed = false;
-            emitKey(config.start, true, config.start_modifier);
-            SDL_Delay(16);
-            emitKey(config.start, is_pressed, config.start_modifier);
-            //note: start cannot be assigned for key repeat; release key repeat for completeness
-            if ((config.start_repeat && is_pressed && (state.key_to_repeat == 0)) || (!(is_pressed) && (state.key_to_repeat == config.start))){
-                setKeyRepeat(config.start, is_pressed);
-            }
-        } else { //process start key as normal
-            emitKey(config.start, is_pressed, config.start_modifier);
-            if ((config.start_repeat && is_pressed && (state.key_to_repeat == 0)) || (!(is_pressed) && (state.key_to_repeat == config.start))){
-                setKeyRepeat(config.start, is_pressed);
-            }
-        }
-        break;
-    } //switch
-    if ((kill_mode) && (state.start_pressed && state.hotkey_pressed)) {
-        doKillMode();
-    } //kill mode 
-    else if ((textinputpreset_mode) && (state.textinputpresettrigger_pressed && state.start_pressed)) { //activate input preset mode - send predefined text as a series of keystrokes
-        printf("text input preset pressed\n");
-        state.start_combo_triggered = true;
-        if (state.start_jsdevice == state.textinputpresettrigger_jsdevice) {
-            if (config.text_input_preset != NULL) {
-                printf("text input processing %s\n", config.text_input_preset);
-                processKeys();
-            }
+// Sector mode: the stick's angle picks one of 4 or 8 directions, a diagonal pressing the keys of
+// both its sides, and the distance from the centre uses the press and release thresholds.
+// Going from one direction to another is a single frame, releases first, key combinations
+// included. Macros and tap/hold bindings can't be part of a frame, so they go through emitKey
+// around it.
+static void analogSectorKeys(int x, int y, int ways, int press, int release, int& sector,
+    const short keys[4], const short modifiers[4], const bool repeats[4], bool* held[4])
+{
+    long long distance = (long long)x * x + (long long)y * y;
+    long long threshold = sector < 0 ? press : release;
+    bool active = sector < 0 ? distance > threshold * threshold : distance >= threshold * threshold;
+
+    sector = active ? stick_sector(stick_angle(x, y), ways, sector) : -1;
+
+    std::vector<short> before, after;
+    bool pressed[4], released[4], special[4];
+    for (int ii = 0; ii < 4; ii++) {
+        bool wanted = sector >= 0 && sector_directions[sector][ii];
+        bool plain = true;
+        if (*held[ii])
+            plain = bindingKeys(keys[ii], modifiers[ii], before);
+        if (wanted)
+            plain = bindingKeys(keys[ii], modifiers[ii], after);
+
+        pressed[ii] = wanted && !*held[ii];
+        released[ii] = !wanted && *held[ii];
+        special[ii] = !plain;
+        *held[ii] = wanted;
+        if (special[ii] && released[ii])
+            emitKey(keys[ii], false, modifiers[ii]);
+    }
+
+    key_frame frame;
+    for (auto it = before.rbegin(); it != before.rend(); ++it) {
+        if (std::find(after.begin(), after.end(), *it) == after.end())
+            sectorFrameAdd(frame, *it, false);
+    }
+    for (short code : after) {
+        if (std::find(before.begin(), before.end(), code) == before.end())
+            sectorFrameAdd(frame, code, true);
+    }
+    emitKeyFrame(frame);
+
+    // repeat like the threshold mode: the first key pressed repeats until it is let go
+    for (int ii = 0; ii < 4; ii++) {
+        if (pressed[ii]) {
+            if (special[ii])
+                emitKey(keys[ii], true, modifiers[ii]);
+            if (repeats[ii] && state.key_to_repeat == 0)
+                setKeyRepeat(keys[ii], true);
+        } else if (released[ii] && repeats[ii] && state.key_to_repeat == keys[ii]) {
+            setKeyRepeat(keys[ii], false);
         }
-        state.textinputpresettrigger_pressed = false; //reset textinputpreset trigger
-        state.start_pressed = false;
-        state.start_jsdevice = 0;
-        state.textinputpresettrigger_jsdevice = 0;
-    } //input preset trigger mode (i.e. not kill mode)
-    else if ((textinputpreset_mode) && (state.textinputconfirmtrigger_pressed && state.start_pressed)) { //activate input preset confirm mode - send ENTER key
-        printf("text input confirm pressed\n");
-        state.start_combo_triggered = true;
-        if (state.start_jsdevice == state.textinputconfirmtrigger_jsdevice) {
-            printf("text input Enter key\n");
-            emitKey(char_to_keycode("enter"), true);
-            SDL_Delay(15);
-            emitKey(char_to_keycode("enter"), false);
+    }
+}
+
+#define _ANALOG_SECTOR_KEYS(STICK) \
+    { \
+        const short keys[4] = {config.STICK ## _up, config.STICK ## _down, config.STICK ## _left, config.STICK ## _right}; \
+        const short modifiers[4] = {config.STICK ## _up_modifier, config.STICK ## _down_modifier, \
+            config.STICK ## _left_modifier, config.STICK ## _right_modifier}; \
+        const bool repeats[4] = {config.STICK ## _up_repeat, config.STICK ## _down_repeat, \
+            config.STICK ## _left_repeat, config.STICK ## _right_repeat}; \
+        bool* held[4] = {&state.STICK ## _was_up, &state.STICK ## _was_down, &state.STICK ## _was_left, &state.STICK ## _was_right}; \
+        analogSectorKeys(state.current_ ## STICK ## _x, state.current_ ## STICK ## _y, config.STICK ## _ways, \
+            STICK ## _press, STICK ## _release, state.STICK ## _sector, keys, modifiers, repeats, held); \
+    }
+
+#define _ANALOG_AXIS_TRIGGER(STICK, DIRECTION, AXIS, SIGN) \
+    analogDirectionKey((SIGN) * state.current_ ## STICK ## _ ## AXIS, STICK ## _press, STICK ## _release, \
+        config.STICK ## _min_hold, state.STICK ## _was_ ## DIRECTION, state.STICK ## _since_ ## DIRECTION, \
+        config.STICK ## _ ## DIRECTION, config.STICK ## _ ## DIRECTION ## _modifier, config.STICK ## _ ## DIRECTION ## _repeat);
+
+#define _ANALOG_AXIS_PULSE(STICK, INDEX, DIRECTION, AXIS, SIGN) \
+    setAnalogPulse(INDEX, (SIGN) * state.current_ ## STICK ## _ ## AXIS, STICK ## _press, STICK ## _release, \
+        config.STICK ## _pulse, config.STICK ## _ ## DIRECTION, config.STICK ## _ ## DIRECTION ## _modifier);
+
+static void updateAnalogKeys(bool left_axis_movement, bool right_axis_movement)
+{
+    int left_analog_press, left_analog_release, right_analog_press, right_analog_release;
+    analogThresholds(config.left_analog_press, config.left_analog_release, left_analog_press, left_analog_release);
+    analogThresholds(config.right_analog_press, config.right_analog_release, right_analog_press, right_analog_release);
+
+    if (left_axis_movement && !config.left_analog_as_mouse && !config.left_analog_as_scroll && !config.left_analog_as_absolute) {
+        if (config.left_analog_ways != 0) {
+            _ANALOG_SECTOR_KEYS(left_analog)
+        } else if (config.left_analog_pulse != 0) {
+            _ANALOG_AXIS_PULSE(left_analog, 0, up,    y, -1)
+            _ANALOG_AXIS_PULSE(left_analog, 1, down,  y,  1)
+            _ANALOG_AXIS_PULSE(left_analog, 2, left,  x, -1)
+            _ANALOG_AXIS_PULSE(left_analog, 3, right, x,  1)
+        } else {
+            _ANALOG_AXIS_TRIGGER(left_analog, up,    y, -1)
+            _ANALOG_AXIS_TRIGGER(left_analog, down,  y,  1)
+            _ANALOG_AXIS_TRIGGER(left_analog, left,  x, -1)
+            _ANALOG_AXIS_TRIGGER(left_analog, right, x,  1)
         }
-        state.textinputconfirmtrigger_pressed = false; //reset textinputpreset confirm trigger
-        state.start_pressed = false;
-        state.start_jsdevice = 0;
-        state.textinputconfirmtrigger_jsdevice = 0;
-    } //input confirm trigger mode (i.e. not kill mode)         
-    else if ((textinputinteractive_mode) && (state.textinputinteractivetrigger_pressed && state.start_pressed)) { //activate interactive text input mode
-        printf("text input interactive pressed\n");
-        state.start_combo_triggered = true;
-        if (state.start_jsdevice == state.textinputinteractivetrigger_jsdevice) {
-            printf("text input interactive mode active\n");
-            state.textinputinteractive_mode_active = true;
-            SDL_RemoveTimer( state.key_repeat_timer_id ); // disable any active key repeat timer
-            current_character = 0;
-
-            addTextInputCharacter();
+    }
+    if (right_axis_movement && !config.right_analog_as_mouse && !config.right_analog_as_scroll && !config.right_analog_as_absolute) {
+        if (config.right_analog_ways != 0) {
+            _ANALOG_SECTOR_KEYS(right_analog)
+        } else if (config.right_analog_pulse != 0) {
+            _ANALOG_AXIS_PULSE(right_analog, 4, up,    y, -1)
+            _ANALOG_AXIS_PULSE(right_analog, 5, down,  y,  1)
+            _ANALOG_AXIS_PULSE(right_analog, 6, left,  x, -1)
+            _ANALOG_AXIS_PULSE(right_analog, 7, right, x,  1)
+        } else {
+            _ANALOG_AXIS_TRIGGER(right_analog, up,    y, -1)
+            _ANALOG_AXIS_TRIGGER(right_analog, down,  y,  1)
+            _ANALOG_AXIS_TRIGGER(right_analog, left,  x, -1)
+            _ANALOG_AXIS_TRIGGER(right_analog, right, x,  1)
         }
-        state.textinputinteractivetrigger_pressed = false; //reset interactive text input mode trigger
-        state.start_pressed = false;
-        state.textinputinteractivetrigger_jsdevice = 0;
-        state.start_jsdevice = 0;
     }
 }
 
-#define _ANALOG_AXIS_POS(ANALOG_VALUE) !_ANALOG_AXIS_ZERO(ANALOG_VALUE) && ((ANALOG_VALUE) > config.deadzone)
-#define _ANALOG_AXIS_NEG(ANALOG_VALUE) !_ANALOG_AXIS_ZERO(ANALOG_VALUE) && ((ANALOG_VALUE) < config.deadzone)
-#define _ANALOG_AXIS_ZERO(ANALOG_VALUE) (abs(ANALOG_VALUE) < config.deadzone)
-
-// #define _ANALOG_AXIS_POS(ANALOG_VALUE) (ANALOG_VALUE > 0)
-// #define _ANALOG_AXIS_NEG(ANALOG_VALUE) (ANALOG_VALUE < 0)
-// #define _ANALOG_AXIS_ZERO(ANALOG_VALUE) (ANALOG_VALUE == 0)
+static Uint32 analogHoldCallback(Uint32, void*)
+{
+    state.analog_hold_timer_id = 0;
+    if (!state.textinputinteractive_mode_active) {
+        updateAnalogKeys(true, true); // let go of whatever has now been held long enough
+    }
+    return 0;
+}
 
-#define _ANALOG_AXIS_TRIGGER(STICK, DIRECTION, AXIS, CONDITION_POS, CONDITION_ZERO) \
-    handleAnalogTrigger( \
-        CONDITION_POS( state.current_ ## STICK ## _ ## AXIS ), \
-        state. STICK ## _was_ ## DIRECTION, \
-        config.STICK ## _ ## DIRECTION, \
-        config.STICK ## _ ## DIRECTION ## _modifier); \
-    if ((CONDITION_POS( state.current_ ## STICK ## _ ## AXIS )) && config.STICK ## _ ## DIRECTION ## _repeat && (state.key_to_repeat == 0)) { \
-        setKeyRepeat(config.STICK ## _ ## DIRECTION, true); \
-    } else if ((CONDITION_ZERO( state.current_ ## STICK ## _ ## AXIS )) && config.STICK ## _ ## DIRECTION ## _repeat && (state.key_to_repeat == config.STICK ## _ ## DIRECTION)) { \
-        setKeyRepeat(config.STICK ## _ ## DIRECTION, false); \
+// Looks at the sticks again once a key held for less than min_hold may be let go
+static void scheduleAnalogHold(Uint32 wait)
+{
+    Uint32 due = SDL_GetTicks() + wait;
+    if (state.analog_hold_timer_id != 0) {
+        if ((Sint32)(due - state.analog_hold_due) >= 0)
+            return;
+        removeLoopTimer(state.analog_hold_timer_id);
     }
+    state.analog_hold_due = due;
+    state.analog_hold_timer_id = addLoopTimer(wait, analogHoldCallback, NULL);
+}
 
 
+// Work out the pointer and wheel speeds from every stick that drives one
+static void updateStickMouse()
+{
+    int x, y;
+
+    state.mouseX = state.mouseY = 0;
+    state.scrollX = state.scrollY = 0;
+
+    if (config.left_analog_as_mouse || config.left_analog_as_scroll) {
+        deadzone_calc(x, y, state.current_left_analog_x, state.current_left_analog_y);
+        (config.left_analog_as_mouse ? state.mouseX : state.scrollX) += x;
+        (config.left_analog_as_mouse ? state.mouseY : state.scrollY) += y;
+    }
+    if (config.right_analog_as_mouse || config.right_analog_as_scroll) {
+        deadzone_calc(x, y, state.current_right_analog_x, state.current_right_analog_y);
+        (config.right_analog_as_mouse ? state.mouseX : state.scrollX) += x;
+        (config.right_analog_as_mouse ? state.mouseY : state.scrollY) += y;
+    }
+}
+
 void handleEventAxisFakeKeyboardMouseDevice(const SDL_Event &event)
 {
     // indicate which axis was moved before checking whether it's assigned as mouse
@@ -809,64 +919,31 @@ void handleEventAxisFakeKeyboardMouseDevice(const SDL_Event &event)
         break;
     } // switch (event.caxis.axis)
 
-    // fake mouse
-    if (config.left_analog_as_mouse && left_axis_movement) {
-        deadzone_calc(
-            state.mouseX, state.mouseY,
-            state.current_left_analog_x, state.current_left_analog_y);
-    } else if (config.right_analog_as_mouse && right_axis_movement) {
-        deadzone_calc(
-            state.mouseX, state.mouseY,
-            state.current_right_analog_x, state.current_right_analog_y);
-    } else {
-        // Analogs trigger keys
-        if (!(state.textinputinteractive_mode_active)) {
-            _ANALOG_AXIS_TRIGGER(left_analog, up,    y, _ANALOG_AXIS_NEG, _ANALOG_AXIS_ZERO)
-            _ANALOG_AXIS_TRIGGER(left_analog, down,  y, _ANALOG_AXIS_POS, _ANALOG_AXIS_ZERO)
-            _ANALOG_AXIS_TRIGGER(left_analog, left,  x, _ANALOG_AXIS_NEG, _ANALOG_AXIS_ZERO)
-            _ANALOG_AXIS_TRIGGER(left_analog, right, x, _ANALOG_AXIS_POS, _ANALOG_AXIS_ZERO)
-
-            _ANALOG_AXIS_TRIGGER(right_analog, up,    y, _ANALOG_AXIS_NEG, _ANALOG_AXIS_ZERO)
-            _ANALOG_AXIS_TRIGGER(right_analog, down,  y, _ANALOG_AXIS_POS, _ANALOG_AXIS_ZERO)
-            _ANALOG_AXIS_TRIGGER(right_analog, left,  x, _ANALOG_AXIS_NEG, _ANALOG_AXIS_ZERO)
-            _ANALOG_AXIS_TRIGGER(right_analog, right, x, _ANALOG_AXIS_POS, _ANALOG_AXIS_ZERO)
-        } //!(state.textinputinteractive_mode_active)
-    } // Analogs trigger keys 
-
-    if (state.hotkey_pressed) {
-        handleAnalogTrigger(
-            state.current_l2 > config.deadzone_triggers,
-            state.l2_hk_was_pressed,
-            config.l2_hk,
-            config.l2_hk_modifier);
-        handleAnalogTrigger(
-            state.current_r2 > config.deadzone_triggers,
-            state.r2_hk_was_pressed,
-            config.r2_hk,
-            config.r2_hk_modifier);
-        if (state.l2_hk_was_pressed || state.r2_hk_was_pressed)
-            state.hotkey_combo_triggered = true;
-    } else if (state.l2_hk_was_pressed || state.r2_hk_was_pressed) {
-        handleAnalogTrigger(
-            state.current_l2 > config.deadzone_triggers,
-            state.l2_hk_was_pressed,
-            config.l2_hk,
-            config.l2_hk_modifier);
-        handleAnalogTrigger(
-            state.current_r2 > config.deadzone_triggers,
-            state.r2_hk_was_pressed,
-            config.r2_hk,
-            config.r2_hk_modifier);
-    } else {
-        handleAnalogTrigger(
-            state.current_l2 > config.deadzone_triggers,
-            state.l2_was_pressed,
-            config.l2,
-            config.l2_modifier);
-        handleAnalogTrigger(
-            state.current_r2 > config.deadzone_triggers,
-            state.r2_was_pressed,
-            config.r2,
-            config.r2_modifier);
+    // fake mouse and scroll wheel, each stick on its own so both can be used at once
+    if (left_axis_movement || right_axis_movement) {
+        updateStickMouse();
+    }
+
+    // the absolute pointer only moves when the stick does, there's nothing to send every tick
+    int abs_x, abs_y;
+    if (config.left_analog_as_absolute && left_axis_movement
+        && absolute_calc(abs_x, abs_y, state.current_left_analog_x, state.current_left_analog_y)) {
+        emitAbsolutePointer(abs_x, abs_y);
+    } else if (config.right_analog_as_absolute && right_axis_movement
+        && absolute_calc(abs_x, abs_y, state.current_right_analog_x, state.current_right_analog_y)) {
+        emitAbsolutePointer(abs_x, abs_y);
+    }
+
+    // Analogs trigger keys
+    if (!(state.textinputinteractive_mode_active)) {
+        updateAnalogKeys(left_axis_movement, right_axis_movement);
+    } //!(state.textinputinteractive_mode_active)
+
+    // the triggers act as buttons once they pass deadzone_triggers
+    if ((state.current_l2 > config.deadzone_triggers) != (GBTN_CHECK_BTN(L2) != 0)) {
+        handleButton(GBTN_L2, state.current_l2 > config.deadzone_triggers);
+    }
+    if ((state.current_r2 > config.deadzone_triggers) != (GBTN_CHECK_BTN(R2) != 0)) {
+        handleButton(GBTN_R2, state.current_r2 > config.deadzone_triggers);
     }
 }
@@ -0,0 +1,355 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+#include "gptokeyb.h"
+
+#include <ctype.h>
+
+// Macros bind a button to a timed sequence of keys, e.g. "a = macro:ctrl+s,wait30,enter".
+// Steps are separated by commas:
+//
+//   ctrl+s      tap: press all the keys in one frame, release them in reverse in the next
+//   down:shift  press and keep holding
+//   up:shift    release a key held by down:
+//   wait30      wait another 30 milliseconds before the next frame
+//
+// Frames are macro_delay milliseconds apart. Each macro is compiled into key frames when the
+// profile is loaded, and bound to a code above KEY_MAX so every binding can use one; emitKey
+// hands those codes to the scheduler instead of the device, so nothing waits in SDL_Delay.
+
+// Split "ctrl+s" into key codes; a separator where a name is expected is the key itself,
+// so "shift++" is shift and plus.
+static const char* nextKeyName(const char* text, char separator, std::string& name)
+{
+    name.clear();
+    if (*text == separator)
+        name += *text++;
+    while (*text != '\0' && *text != separator)
+        name += *text++;
+    return text;
+}
+
+bool parseKeyChord(const char* text, std::vector<short>& keys)
+{
+    std::string name;
+
+    keys.clear();
+    while (*text != '\0') {
+        text = nextKeyName(text, '+', name);
+        short code = char_to_keycode(name.c_str());
+        if (code == 0 || code >= MACRO_CODE_BASE) {
+            printf("unknown key '%s'\n", name.c_str());
+            return false;
+        }
+        keys.push_back(code);
+
+        if (*text == '+')
+            text++;
+    }
+    return !keys.empty();
+}
+
+bool compileMacro(const char* text, Uint32 delay, std::vector<key_frame>& frames)
+{
+    std::vector<short> held;
+    std::vector<short> keys;
+    std::string step;
+    Uint32 gap = 0; // the first frame goes out straight away
+
+    frames.clear();
+    while (*text != '\0') {
+        text = nextKeyName(text, ',', step);
+        if (*text == ',')
+            text++;
+
+        if (step.compare(0, 4, "wait") == 0 && step.size() > 4 && isdigit((unsigned char)step[4])) {
+            gap += atoi(step.c_str() + 4);
+            continue;
+        }
+
+        bool press = true;
+        bool release = true;
+        const char* chord = step.c_str();
+        if (step.compare(0, 5, "down:") == 0) {
+            release = false;
+            chord += 5;
+        } else if (step.compare(0, 3, "up:") == 0) {
+            press = false;
+            chord += 3;
+        }
+        if (!parseKeyChord(chord, keys) || keys.size() > KEY_FRAME_MAX) {
+            printf("invalid macro step '%s'\n", step.c_str());
+            return false;
+        }
+
+        if (press) {
+            key_frame frame;
+            frame.delay = gap;
+            for (short code : keys) {
+                keyFrameAdd(frame, code, true);
+                held.push_back(code);
+            }
+            frames.push_back(frame);
+            gap = delay;
+        }
+        if (release) {
+            key_frame frame;
+            frame.delay = gap;
+            for (auto it = keys.rbegin(); it != keys.rend(); ++it) {
+                keyFrameAdd(frame, *it, false);
+                for (auto held_it = held.begin(); held_it != held.end(); ++held_it) {
+                    if (*held_it == *it) {
+                        held.erase(held_it);
+                        break;
+                    }
+                }
+            }
+            frames.push_back(frame);
+            gap = delay;
+        }
+    }
+
+    // never leave a key held after the macro has finished
+    for (size_t ii = 0; ii < held.size(); ii += KEY_FRAME_MAX) {
+        key_frame frame;
+        frame.delay = gap;
+        for (size_t jj = ii; jj < held.size() && jj < ii + KEY_FRAME_MAX; jj++)
+            keyFrameAdd(frame, held[held.size() - 1 - jj], false);
+        frames.push_back(frame);
+        gap = 0;
+    }
+
+    return !frames.empty();
+}
+
+// Returns the code to bind for the macro, or 0 if it doesn't parse
+short addConfigMacro(const char* text)
+{
+    std::vector<key_frame> frames;
+
+    for (size_t ii = 0; ii < config.macro_text.size(); ii++) {
+        if (config.macro_text[ii] == text)
+            return MACRO_CODE_BASE + ii;
+    }
+    if (config.macro_text.size() >= MACRO_MAX) {
+        printf("too many macros, ignoring macro:%s\n", text);
+        return 0;
+    }
+    if (!compileMacro(text, config.macro_delay, frames)) {
+        printf("ignoring macro:%s\n", text);
+        return 0;
+    }
+
+    config.macro_text.push_back(text);
+    config.macros.push_back(frames);
+    return MACRO_CODE_BASE + config.macro_text.size() - 1;
+}
+
+// macro_delay may come after the macros in the profile, so compile them again once it's read
+void compileConfigMacros()
+{
+    for (size_t ii = 0; ii < config.macro_text.size(); ii++) {
+        compileMacro(config.macro_text[ii].c_str(), config.macro_delay, config.macros[ii]);
+    }
+}
+
+void playMacro(int code)
+{
+    size_t index = code - MACRO_CODE_BASE;
+
+    if (code < MACRO_CODE_BASE || index >= config.macros.size())
+        return;
+    queueKeyFrames(config.macros[index], STREAM_MACRO, false);
+}
+
+// Returns the code to bind for keys held together, or 0 if there are too many. A single key is
+// bound as itself. Both frames are built here, so a press or release is one write to the device.
+short addConfigCombo(const std::vector<short>& keys)
+{
+    key_combo combo;
+
+    if (keys.size() == 1)
+        return keys[0];
+    for (size_t ii = 0; ii < config.combos.size(); ii++) {
+        if (config.combos[ii].keys == keys)
+            return COMBO_CODE_BASE + ii;
+    }
+    if (keys.empty() || keys.size() > KEY_FRAME_MAX || config.combos.size() >= COMBO_MAX) {
+        printf("too many keys or key combinations\n");
+        return 0;
+    }
+
+    combo.keys = keys;
+    for (short code : keys)
+        keyFrameAdd(combo.press, code, true);
+    for (auto it = keys.rbegin(); it != keys.rend(); ++it)
+        keyFrameAdd(combo.release, *it, false);
+
+    config.combos.push_back(combo);
+    return COMBO_CODE_BASE + config.combos.size() - 1;
+}
+
+// A key name, or keys joined with '+' like "ctrl+shift+s". Returns 0 if it doesn't parse.
+short configKeyCode(const char* value)
+{
+    std::vector<short> keys;
+
+    if (value[0] == '\0' || strchr(value + 1, '+') == NULL)
+        return char_to_keycode(value); // "+" on its own is the plus key
+    if (!parseKeyChord(value, keys)) {
+        printf("ignoring key combination %s\n", value);
+        return 0;
+    }
+    return addConfigCombo(keys);
+}
+
+// The key "add_alt", "add_ctrl" or "add_shift" adds, or 0 for any other value
+short configModifier(const char* value)
+{
+    if (strcmp(value, "add_alt") == 0)
+        return KEY_LEFTALT;
+    if (strcmp(value, "add_ctrl") == 0)
+        return KEY_LEFTCTRL;
+    if (strcmp(value, "add_shift") == 0)
+        return KEY_LEFTSHIFT;
+    return 0;
+}
+
+// "add_ctrl" and friends, once the binding's key is known. The first modifier goes in the binding's _modifier as before, another
+// one turns the binding into a key combination so every modifier is held, in the order added.
+void addConfigModifier(short& code, short& modifier, short added)
+{
+    std::vector<short> keys;
+
+    if (code >= COMBO_CODE_BASE && code < TAPHOLD_CODE_BASE) {
+        keys = config.combos[code - COMBO_CODE_BASE].keys;
+    } else if (code == 0) {
+        return; // nothing bound, nothing to modify
+    } else if (code >= MACRO_CODE_BASE) {
+        printf("modifiers can only be added to keys\n");
+        return;
+    } else if (modifier == 0 || modifier == added) {
+        modifier = added;
+        return;
+    } else {
+        keys.push_back(modifier);
+        keys.push_back(code);
+    }
+
+    for (short key : keys) {
+        if (key == added)
+            return;
+    }
+    keys.insert(keys.end() - 1, added);
+
+    short combo = addConfigCombo(keys);
+    if (combo != 0) {
+        code = combo;
+        modifier = 0;
+    }
+}
+
+// Adds the plain key codes a binding presses, in press order, for code that batches several
+// bindings into one frame. A key combination gives all of its keys. Returns false for macros
+// and tap/hold bindings, which only emitKey can play.
+bool bindingKeys(short code, short modifier, std::vector<short>& keys)
+{
+    if (code == 0)
+        return true;
+    if (code >= COMBO_CODE_BASE && code < TAPHOLD_CODE_BASE) {
+        size_t index = code - COMBO_CODE_BASE;
+        if (index >= config.combos.size())
+            return true;
+        if (modifier != 0)
+            keys.push_back(modifier);
+        keys.insert(keys.end(), config.combos[index].keys.begin(), config.combos[index].keys.end());
+        return true;
+    }
+    if (code >= MACRO_CODE_BASE)
+        return false;
+
+    if (modifier != 0)
+        keys.push_back(modifier);
+    keys.push_back(code);
+    return true;
+}
+
+void emitCombo(int code, bool is_pressed)
+{
+    size_t index = code - COMBO_CODE_BASE;
+
+    if (code < COMBO_CODE_BASE || index >= config.combos.size())
+        return;
+    emitKeyFrame(is_pressed ? config.combos[index].press : config.combos[index].release);
+}
+
+// Press a key (and modifier) now and release it after hold milliseconds, without blocking.
+// The frames go out on the tag stream, so a caller can wait for them with keyFramesPending.
+void queueKeyTap(short code, short modifier, Uint32 hold, int tag)
+{
+    std::vector<key_frame> frames(2);
+
+    if (code >= TAPHOLD_CODE_BASE)
+        code = tapHoldTapCode(code);
+    if (code == 0)
+        return;
+    if (code >= COMBO_CODE_BASE) {
+        size_t index = code - COMBO_CODE_BASE;
+        if (index >= config.combos.size())
+            return;
+        frames[0] = config.combos[index].press;
+        frames[1] = config.combos[index].release;
+        frames[1].delay = hold;
+        queueKeyFrames(frames, tag, false);
+        return;
+    }
+    if (code >= MACRO_CODE_BASE) {
+        playMacro(code);
+        return;
+    }
+
+    if (modifier != 0)
+        keyFrameAdd(frames[0], modifier, true);
+    keyFrameAdd(frames[0], code, true);
+
+    frames[1].delay = hold;
+    keyFrameAdd(frames[1], code, false);
+    if (modifier != 0)
+        keyFrameAdd(frames[1], modifier, false);
+
+    queueKeyFrames(frames, tag, false);
+}
@@ -0,0 +1,237 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+#include "gptokeyb.h"
+
+// Counters are plain integers bumped on the main loop; they are only formatted into the
+// Prometheus text format when the metrics file is written or the control socket asks for them.
+
+static std::string metrics_path;
+static std::string metrics_profile;
+static std::string metrics_app;
+static int metrics_timer_id = 0;
+
+static void addLatency(latency_histogram& histogram, Uint64 us)
+{
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && us >= (1ULL << bucket))
+        bucket++;
+
+    histogram.bucket[bucket]++;
+    histogram.count++;
+    histogram.sum_us += us;
+}
+
+void countInputEvent(const SDL_Event& event, Uint64 start)
+{
+    switch (event.type) {
+    case SDL_CONTROLLERBUTTONDOWN:
+    case SDL_CONTROLLERBUTTONUP:
+        metrics.events_in[METRIC_IN_BUTTON]++;
+        break;
+    case SDL_CONTROLLERAXISMOTION:
+        metrics.events_in[METRIC_IN_AXIS]++;
+        break;
+    case SDL_CONTROLLERDEVICEADDED:
+    case SDL_CONTROLLERDEVICEREMOVED:
+        metrics.events_in[METRIC_IN_DEVICE]++;
+        break;
+    default:
+        metrics.events_in[METRIC_IN_OTHER]++;
+        return; // not input, so no latency to speak of
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    addLatency(metrics.input_handling, (now - start) * 1000000 / SDL_GetPerformanceFrequency());
+
+    Sint32 queued = (Sint32)(SDL_GetTicks() - event.common.timestamp);
+    addLatency(metrics.input_queue, queued > 0 ? (Uint64)queued * 1000 : 0);
+}
+
+void setMetricsLabels(const char* profile, const char* app)
+{
+    if (profile != NULL)
+        metrics_profile = profile;
+    if (app != NULL)
+        metrics_app = app;
+}
+
+// Estimate a quantile from the histogram, interpolating inside the bucket it falls in
+static double latencyQuantile(const latency_histogram& histogram, double quantile)
+{
+    if (histogram.count == 0)
+        return 0.0;
+
+    Uint64 target = (Uint64)(quantile * histogram.count + 0.5);
+    Uint64 seen = 0;
+    if (target == 0)
+        target = 1;
+
+    for (int ii = 0; ii < LATENCY_BUCKETS; ii++) {
+        if (histogram.bucket[ii] == 0 || seen + histogram.bucket[ii] < target) {
+            seen += histogram.bucket[ii];
+            continue;
+        }
+        double low = (ii == 0) ? 0.0 : (double)(1ULL << (ii - 1));
+        double high = (double)(1ULL << ii);
+        return (low + (high - low) * (target - seen) / histogram.bucket[ii]) / 1000000.0;
+    }
+    return (double)(1ULL << (LATENCY_BUCKETS - 1)) / 1000000.0;
+}
+
+static std::string escapeLabel(const std::string& value)
+{
+    std::string result;
+    for (char ch : value) {
+        if (ch == '\\' || ch == '"') {
+            result += '\\';
+            result += ch;
+        } else if (ch == '\n') {
+            result += "\\n";
+        } else {
+            result += ch;
+        }
+    }
+    return result;
+}
+
+static void formatCounter(std::string& out, const char* name, const char* help, Uint64 value)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", name, help, name, name, (unsigned long long)value);
+    out += line;
+}
+
+static void formatSummary(std::string& out, const char* name, const char* help, const latency_histogram& histogram)
+{
+    const double quantiles[] = { 0.5, 0.9, 0.99 };
+    char line[256];
+
+    snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s summary\n", name, help, name);
+    out += line;
+    for (double quantile : quantiles) {
+        snprintf(line, sizeof(line), "%s{quantile=\"%g\"} %.6f\n", name, quantile, latencyQuantile(histogram, quantile));
+        out += line;
+    }
+    snprintf(line, sizeof(line), "%s_sum %.6f\n%s_count %llu\n", name, histogram.sum_us / 1000000.0,
+        name, (unsigned long long)histogram.count);
+    out += line;
+}
+
+std::string formatMetrics()
+{
+    const char* in_types[METRIC_IN_COUNT] = { "button", "axis", "device", "other" };
+    const char* out_types[EV_CNT] = {};
+    std::string out;
+    char line[256];
+
+    out_types[EV_SYN] = "syn";
+    out_types[EV_KEY] = "key";
+    out_types[EV_REL] = "rel";
+    out_types[EV_ABS] = "abs";
+    out_types[EV_FF] = "ff";
+
+    out += "# HELP gptokeyb_info Profile and application gptokeyb is running with\n# TYPE gptokeyb_info gauge\n";
+    out += "gptokeyb_info{profile=\"" + escapeLabel(metrics_profile) + "\",app=\"" + escapeLabel(metrics_app)
+        + "\",mode=\"" + (xbox360_mode ? "xbox360" : "keyboard") + "\"} 1\n";
+
+    out += "# HELP gptokeyb_events_in_total Controller events received from SDL\n# TYPE gptokeyb_events_in_total counter\n";
+    for (int ii = 0; ii < METRIC_IN_COUNT; ii++) {
+        snprintf(line, sizeof(line), "gptokeyb_events_in_total{type=\"%s\"} %llu\n", in_types[ii], (unsigned long long)metrics.events_in[ii]);
+        out += line;
+    }
+
+    out += "# HELP gptokeyb_events_out_total Events written to the virtual device\n# TYPE gptokeyb_events_out_total counter\n";
+    for (int ii = 0; ii < EV_CNT; ii++) {
+        if (out_types[ii] == NULL && metrics.events_out[ii] == 0)
+            continue;
+        if (out_types[ii] != NULL) {
+            snprintf(line, sizeof(line), "gptokeyb_events_out_total{type=\"%s\"} %llu\n", out_types[ii], (unsigned long long)metrics.events_out[ii]);
+        } else {
+            snprintf(line, sizeof(line), "gptokeyb_events_out_total{type=\"%d\"} %llu\n", ii, (unsigned long long)metrics.events_out[ii]);
+        }
+        out += line;
+    }
+
+    formatCounter(out, "gptokeyb_uinput_writes_total", "write() calls on the uinput device", metrics.uinput_writes);
+    formatCounter(out, "gptokeyb_uinput_bytes_total", "Bytes written to the uinput device", metrics.uinput_bytes);
+    formatCounter(out, "gptokeyb_uinput_dropped_writes_total", "Writes to the uinput device that failed or were cut short", metrics.uinput_dropped);
+    formatCounter(out, "gptokeyb_repeat_ticks_total", "Key repeat timer ticks", metrics.repeat_ticks);
+    formatCounter(out, "gptokeyb_mouse_ticks_total", "Mouse motion frames", metrics.mouse_ticks);
+    formatCounter(out, "gptokeyb_text_chars_total", "Characters queued for text input", metrics.text_chars);
+    formatSummary(out, "gptokeyb_input_handling_seconds", "Time spent handling one controller event", metrics.input_handling);
+    formatSummary(out, "gptokeyb_input_queue_seconds", "Time controller events waited in SDL's queue (millisecond resolution)", metrics.input_queue);
+    return out;
+}
+
+bool writeMetricsFile()
+{
+    if (metrics_path.empty())
+        return false;
+
+    // write the whole file next to the real one and rename it over, so scrapers never see half of it
+    std::string tmp_path = metrics_path + ".tmp";
+    std::string text = formatMetrics();
+    FILE* fp = fopen(tmp_path.c_str(), "w");
+    if (fp == NULL)
+        return false;
+
+    bool written = fwrite(text.data(), 1, text.size(), fp) == text.size();
+    if (fclose(fp) != 0 || !written || rename(tmp_path.c_str(), metrics_path.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+static Uint32 metricsTimerCallback(Uint32, void*)
+{
+    writeMetricsFile();
+    if (config.metrics_interval == 0)
+        metrics_timer_id = 0;
+    return config.metrics_interval;
+}
+
+void startMetricsExport(const char* path)
+{
+    metrics_path = path;
+    if (!writeMetricsFile())
+        printf("Unable to write metrics to %s: %s\n", path, strerror(errno));
+    if (config.metrics_interval > 0 && metrics_timer_id == 0) {
+        metrics_timer_id = addLoopTimer(config.metrics_interval, metricsTimerCallback, NULL);
+    }
+}
@@ -0,0 +1,375 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+#include "gptokeyb.h"
+
+#include <dirent.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include <string>
+
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open 434 // same number on every architecture
+#endif
+#ifndef __NR_pidfd_send_signal
+#define __NR_pidfd_send_signal 424
+#endif
+
+#define TASK_COMM_LEN 16
+
+extern char** environ;
+
+pid_t child_pid = 0;
+bool child_running = false;
+int child_status = 0;
+static int child_pidfd = -1;
+
+int pidfdOpen(pid_t pid)
+{
+    return syscall(__NR_pidfd_open, pid, 0);
+}
+
+static int pidfdSendSignal(int pidfd, int sig)
+{
+    return syscall(__NR_pidfd_send_signal, pidfd, sig, NULL, 0);
+}
+
+// Run a program without going through a shell, optionally waiting for it to finish
+int spawnProcess(const char* const argv[], bool wait)
+{
+    pid_t pid;
+    int status = 0;
+
+    if (posix_spawnp(&pid, argv[0], NULL, NULL, const_cast<char* const*>(argv), environ) != 0)
+        return -1;
+    if (!wait)
+        return 0;
+
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR)
+            return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static bool readProcFile(pid_t pid, const char* file, char* buffer, size_t size)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/%s", (int)pid, file);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    ssize_t len = read(fd, buffer, size - 1);
+    close(fd);
+    if (len <= 0)
+        return false;
+
+    buffer[len] = '\0';
+    return true;
+}
+
+// Match processes the same way killall does: by comm, and by the name the process was
+// started as when the name is too long to fit in comm.
+static bool processMatches(pid_t pid, const char* name)
+{
+    char comm[TASK_COMM_LEN + 1];
+    if (!readProcFile(pid, "comm", comm, sizeof(comm)))
+        return false;
+    comm[strcspn(comm, "\n")] = '\0';
+
+    if (strcmp(comm, name) == 0)
+        return true;
+    if (strlen(name) < TASK_COMM_LEN - 1 || strncmp(comm, name, TASK_COMM_LEN - 1) != 0)
+        return false;
+
+    char cmdline[PATH_MAX];
+    if (!readProcFile(pid, "cmdline", cmdline, sizeof(cmdline)))
+        return false;
+
+    const char* base = strrchr(cmdline, '/');
+    return strcmp(base ? base + 1 : cmdline, name) == 0;
+}
+
+std::vector<pid_t> findProcesses(const char* name)
+{
+    std::vector<pid_t> result;
+    pid_t self = getpid();
+
+    DIR* dir = opendir("/proc");
+    if (dir == NULL)
+        return result;
+
+    while (struct dirent* entry = readdir(dir)) {
+        char* end;
+        long pid = strtol(entry->d_name, &end, 10);
+        if (*end != '\0' || pid <= 0 || pid == self)
+            continue;
+
+        if (processMatches((pid_t)pid, name))
+            result.push_back((pid_t)pid);
+    }
+    closedir(dir);
+
+    return result;
+}
+
+// Signal through the pidfd where there is one, so the signal can't reach another process that
+// was given a recycled pid. sudo only takes a pid, so that fallback can't be as careful.
+static void signalProcesses(const std::vector<pid_t>& pids, const std::vector<int>& pidfds, int sig, bool use_sudo)
+{
+    std::vector<std::string> sudo_args;
+
+    for (size_t ii = 0; ii < pids.size(); ii++) {
+        int result;
+        if (pidfds[ii] >= 0) {
+            result = pidfdSendSignal(pidfds[ii], sig);
+            if (result < 0 && errno == ENOSYS)
+                result = kill(pids[ii], sig); // pidfd_open works but pidfd_send_signal doesn't
+        } else {
+            result = kill(pids[ii], sig);
+        }
+        if (result == 0 || errno != EPERM)
+            continue;
+        if (use_sudo)
+            sudo_args.push_back(std::to_string(pids[ii]));
+    }
+
+    if (!sudo_args.empty()) {
+        std::string signal_arg = "-" + std::to_string(sig);
+        std::vector<const char*> argv = {"sudo", "kill", signal_arg.c_str()};
+        for (const auto& arg : sudo_args)
+            argv.push_back(arg.c_str());
+        argv.push_back(NULL);
+        spawnProcess(argv.data(), true);
+    }
+}
+
+// Wait for the processes to exit, for at most timeout milliseconds. Processes that have
+// exited are removed from pids, so what is left afterwards are the survivors.
+static void waitProcesses(std::vector<pid_t>& pids, std::vector<int>& pidfds, Uint32 timeout)
+{
+    Uint32 start = SDL_GetTicks();
+
+    while (!pids.empty()) {
+        Sint32 remaining = (Sint32)(start + timeout - SDL_GetTicks());
+        if (remaining <= 0)
+            break;
+
+        std::vector<pollfd> fds;
+        bool need_polling = false; // no pidfd for some of them, so check on them periodically
+        for (int fd : pidfds) {
+            if (fd < 0) {
+                need_polling = true;
+                continue;
+            }
+            pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            fds.push_back(pfd);
+        }
+        poll(fds.data(), fds.size(), need_polling && remaining > 10 ? 10 : remaining);
+
+        size_t next_fd = 0;
+        for (size_t ii = 0; ii < pids.size();) {
+            bool exited;
+            if (pidfds[ii] >= 0) {
+                exited = (fds[next_fd++].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+            } else {
+                exited = (kill(pids[ii], 0) < 0 && errno == ESRCH);
+            }
+
+            if (exited) {
+                if (pidfds[ii] >= 0)
+                    close(pidfds[ii]);
+                pids.erase(pids.begin() + ii);
+                pidfds.erase(pidfds.begin() + ii);
+            } else {
+                ii++;
+            }
+        }
+    }
+}
+
+// Ask every process called name to terminate, and only kill the ones that are still around
+// after timeout milliseconds. Returns as soon as they are all gone.
+void killProcesses(const char* name, bool use_sudo, Uint32 timeout)
+{
+    std::vector<pid_t> pids = findProcesses(name);
+    std::vector<int> pidfds;
+
+    if (pids.empty())
+        return;
+
+    // hold a pidfd for each process and check it is still the one we found, so a recycled pid
+    // can't be signalled or mistaken for the process we signalled
+    for (size_t ii = 0; ii < pids.size();) {
+        int fd = pidfdOpen(pids[ii]);
+        if (fd >= 0 && !processMatches(pids[ii], name)) {
+            close(fd);
+            pids.erase(pids.begin() + ii);
+            continue;
+        }
+        pidfds.push_back(fd);
+        ii++;
+    }
+
+    signalProcesses(pids, pidfds, SIGTERM, use_sudo);
+    waitProcesses(pids, pidfds, timeout);
+
+    if (!pids.empty()) {
+        printf("Forcefully Killing: %s\n", name);
+        signalProcesses(pids, pidfds, SIGKILL, use_sudo);
+    }
+
+    for (int fd : pidfds) {
+        if (fd >= 0)
+            close(fd);
+    }
+}
+
+// Supervisor mode: the game is started by us in its own process group, so kill mode can
+// signal exactly that group and gptokeyb exits as soon as the game does.
+
+static bool reapChild(bool block)
+{
+    int status;
+
+    if (!child_running)
+        return true;
+    if (waitpid(child_pid, &status, block ? 0 : WNOHANG) != child_pid)
+        return false;
+
+    child_running = false;
+    child_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    return true;
+}
+
+static void childExited()
+{
+    printf("%d exited with status %d\n", (int)child_pid, child_status);
+
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = SDL_QUIT;
+    SDL_PushEvent(&event);
+}
+
+static bool childPidfdCallback(int, void*)
+{
+    if (!reapChild(false))
+        return true;
+
+    childExited();
+    return false;
+}
+
+static Uint32 childPollCallback(Uint32 interval, void*)
+{
+    // only used when the kernel doesn't have pidfd_open
+    if (!reapChild(false))
+        return interval;
+
+    childExited();
+    return 0;
+}
+
+bool launchChild(char* const argv[])
+{
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    int result = posix_spawnp(&child_pid, argv[0], NULL, &attr, argv, environ);
+    posix_spawnattr_destroy(&attr);
+    if (result != 0) {
+        printf("Unable to start %s: %s\n", argv[0], strerror(result));
+        return false;
+    }
+
+    child_running = true;
+    printf("Started %s as %d\n", argv[0], (int)child_pid);
+
+    child_pidfd = pidfdOpen(child_pid);
+    if (child_pidfd >= 0) {
+        fcntl(child_pidfd, F_SETFD, FD_CLOEXEC);
+        addLoopWatch(child_pidfd, childPidfdCallback, NULL);
+    } else {
+        addLoopTimer(100, childPollCallback, NULL);
+    }
+    return true;
+}
+
+// Ask the whole process group to terminate and kill it if the game is still running after
+// timeout milliseconds.
+void stopChild(Uint32 timeout)
+{
+    if (child_pid <= 0)
+        return;
+
+    kill(-child_pid, SIGTERM);
+
+    Uint32 start = SDL_GetTicks();
+    while (!reapChild(false)) {
+        Sint32 remaining = (Sint32)(start + timeout - SDL_GetTicks());
+        if (remaining <= 0)
+            break;
+
+        if (child_pidfd >= 0) {
+            pollfd pfd;
+            pfd.fd = child_pidfd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            poll(&pfd, 1, remaining);
+        } else {
+            SDL_Delay(remaining > 10 ? 10 : remaining);
+        }
+    }
+
+    if (child_running)
+        printf("Forcefully Killing: %d\n", (int)child_pid);
+    kill(-child_pid, SIGKILL); // also takes care of anything the game left behind in its group
+    reapChild(true);
+}
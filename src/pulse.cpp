@@ -0,0 +1,193 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb.h"
+
+#include <algorithm>
+
+// Proportional stick keys, "left_analog_pulse = <period ms>": for games that only take the
+// keyboard, a stick direction's key is held for part of every period, from analog_pulse_min
+// percent just past the press threshold up to all of it with the stick pushed fully, so a
+// half pushed stick walks at about half speed. Every pulsing direction shares one main loop
+// timer, and whatever keys change at the same moment go out as one frame.
+
+#define ANALOG_PULSES 8         // up, down, left, right for each stick
+#define ANALOG_PULSE_FULL 30000 // sticks rarely reach 32767, and not at all on the diagonals
+
+struct analog_pulse
+{
+    int duty = 0;       // percent of the period the key is down, 0 when the stick isn't past the threshold
+    bool on = false;    // whether the key is down right now
+    Uint32 start = 0;   // when the current period started
+    Uint32 period = 0;
+    short keys[KEY_FRAME_MAX]; // the binding's plain keys, in press order
+    int key_count = 0;
+    bool warned = false;       // about a binding that can't be pulsed
+};
+
+static analog_pulse analog_pulses[ANALOG_PULSES];
+static int pulse_timer_id = 0;
+static Uint8 pulse_key_count[KEY_MAX + 1]; // how many pulses hold each key, a shared modifier stays down until the last one lets go
+
+static void pulseEdge(key_frame& frame, analog_pulse& pulse, bool on)
+{
+    pulse.on = on;
+    if (frame.count + pulse.key_count > KEY_FRAME_MAX) {
+        emitKeyFrame(frame); // only with several keys on most directions of both sticks
+        frame.count = 0;
+    }
+    for (int ii = 0; ii < pulse.key_count; ii++) {
+        if (on) {
+            short key = pulse.keys[ii];
+            if (pulse_key_count[key]++ == 0)
+                keyFrameAdd(frame, key, true);
+        } else {
+            short key = pulse.keys[pulse.key_count - 1 - ii];
+            if (--pulse_key_count[key] == 0)
+                keyFrameAdd(frame, key, false);
+        }
+    }
+}
+
+// Adds every edge that is due to the frame, and returns how long until the next one, or 0
+static Uint32 runPulses(key_frame& frame)
+{
+    Uint32 now = SDL_GetTicks();
+    Uint32 next = 0;
+
+    for (auto& pulse : analog_pulses) {
+        if (pulse.duty == 0)
+            continue;
+
+        Uint32 on_time = pulse.period * pulse.duty / 100;
+        if (!pulse.on && now - pulse.start >= pulse.period) {
+            pulse.start = (now - pulse.start >= 2 * pulse.period) ? now : pulse.start + pulse.period;
+            pulseEdge(frame, pulse, true);
+        }
+        if (pulse.on && pulse.duty < 100 && now - pulse.start >= on_time) {
+            pulseEdge(frame, pulse, false);
+        }
+
+        Uint32 wait;
+        if (pulse.on && pulse.duty >= 100)
+            continue; // held for as long as the stick stays out there
+        else if (pulse.on)
+            wait = pulse.start + on_time - now;
+        else
+            wait = pulse.start + pulse.period - now;
+        if (wait == 0)
+            wait = 1;
+        if (next == 0 || wait < next)
+            next = wait;
+    }
+    return next;
+}
+
+static Uint32 pulseCallback(Uint32, void*)
+{
+    key_frame frame;
+    Uint32 next = runPulses(frame);
+    emitKeyFrame(frame);
+    if (next == 0)
+        pulse_timer_id = 0;
+    return next;
+}
+
+static void schedulePulses(key_frame& frame)
+{
+    Uint32 next = runPulses(frame);
+    removeLoopTimer(pulse_timer_id);
+    pulse_timer_id = next != 0 ? addLoopTimer(next, pulseCallback, NULL) : 0;
+}
+
+// Called with a stick direction's value, positive when pushed that way, every time the stick moves.
+// The binding is looked at when the direction starts pulsing.
+void setAnalogPulse(int index, int value, int press, int release, Uint32 period, short key, short modifier)
+{
+    analog_pulse& pulse = analog_pulses[index];
+    bool active = pulse.duty != 0 ? value >= release : value > press;
+
+    int duty = 0;
+    if (active) {
+        int full = press < ANALOG_PULSE_FULL ? ANALOG_PULSE_FULL : press + 1;
+        duty = config.analog_pulse_min + (100 - config.analog_pulse_min) * (value - press) / (full - press);
+        if (duty > 100)
+            duty = 100;
+        if (duty < config.analog_pulse_min)
+            duty = config.analog_pulse_min;
+        if (duty < 1)
+            duty = 1;
+    }
+    if (duty == pulse.duty)
+        return;
+
+    key_frame frame;
+    if (duty == 0) {
+        if (pulse.on)
+            pulseEdge(frame, pulse, false);
+    } else if (pulse.duty == 0) {
+        std::vector<short> keys;
+        if (!bindingKeys(key, modifier, keys) || keys.size() > KEY_FRAME_MAX) {
+            if (!pulse.warned)
+                printf("stick pulse can't play macros or tap/hold bindings, leaving that direction alone\n");
+            pulse.warned = true;
+            return;
+        }
+        if (keys.empty())
+            return;
+
+        std::copy(keys.begin(), keys.end(), pulse.keys);
+        pulse.key_count = keys.size();
+        pulse.period = period;
+        pulse.start = SDL_GetTicks();
+        pulseEdge(frame, pulse, true);
+    }
+    pulse.duty = duty;
+
+    schedulePulses(frame);
+    emitKeyFrame(frame);
+}
+
+void resetPulses()
+{
+    removeLoopTimer(pulse_timer_id);
+    pulse_timer_id = 0;
+    for (auto& pulse : analog_pulses)
+        pulse = analog_pulse(); // the keys themselves are let go by resetInput()
+    memset(pulse_key_count, 0, sizeof(pulse_key_count));
+}
@@ -0,0 +1,233 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb.h"
+
+#include <dirent.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// Telling launch scripts when the virtual device is usable, so they can start the game right
+// away instead of sleeping and hoping. Ready means UI_DEV_CREATE has completed and udev has
+// made the /dev/input/event node, since that is what the game will enumerate. Any of these
+// can be used together:
+//
+//   -ready-fd <n>       write "READY=1\n" to an inherited fd and close it
+//   -ready-file <path>  create the file, holding our pid, and remove it again on exit
+//   -daemonize          fork into the background; the parent exits once we are ready, or
+//                       with status 1 if we fail before that
+//
+// NOTIFY_SOCKET is also honoured, so a systemd Type=notify service works as is.
+
+#define READY_NODE_TIMEOUT 2000 // ms to wait for udev before giving up and saying ready anyway
+#define READY_NODE_POLL 5
+
+static int ready_fd = -1;
+static int daemon_fd = -1; // the pipe back to the parent left behind by -daemonize
+static const char* ready_file = NULL;
+static bool ready_sent = false;
+
+void setReadyFd(int fd)
+{
+    ready_fd = fd;
+}
+
+void setReadyFile(const char* path)
+{
+    ready_file = path;
+}
+
+// Has to run before any thread is started, SDL's included
+bool daemonize()
+{
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) < 0) {
+        printf("Unable to daemonize: %s\n", strerror(errno));
+        return false;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Unable to daemonize: %s\n", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if (pid > 0) {
+        // the parent just waits to hear that the device is there
+        char status = 0;
+        close(fds[1]);
+        while (read(fds[0], &status, 1) < 0 && errno == EINTR)
+            ;
+        if (status != 'R') {
+            printf("gptokeyb failed to start\n");
+            fflush(stdout);
+            _exit(1);
+        }
+        printf("gptokeyb running as %d\n", (int)pid);
+        fflush(stdout);
+        _exit(0);
+    }
+
+    close(fds[0]);
+    daemon_fd = fds[1];
+    setsid();
+
+    int null_fd = open("/dev/null", O_RDONLY);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDIN_FILENO);
+        close(null_fd);
+    }
+    return true;
+}
+
+// The uinput device's /dev/input/event node, found through sysfs
+static std::string deviceNode(int fd)
+{
+    char sysname[64];
+    int len = ioctl(fd, UI_GET_SYSNAME(sizeof(sysname)), sysname);
+    if (len < 0)
+        return "";
+    sysname[sizeof(sysname) - 1] = '\0';
+
+    std::string node;
+    std::string sys_path = std::string("/sys/devices/virtual/input/") + sysname;
+    DIR* dir = opendir(sys_path.c_str());
+    if (dir == NULL)
+        return "";
+    while (struct dirent* entry = readdir(dir)) {
+        if (strncmp(entry->d_name, "event", 5) == 0) {
+            node = std::string("/dev/input/") + entry->d_name;
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+static void waitDeviceNode(int fd)
+{
+    std::string node = deviceNode(fd);
+    if (node.empty())
+        return; // kernels before 3.15 can't tell us, UI_DEV_CREATE has to do
+
+    struct stat st;
+    for (int waited = 0; stat(node.c_str(), &st) != 0; waited += READY_NODE_POLL) {
+        if (waited >= READY_NODE_TIMEOUT) {
+            printf("%s did not appear, carrying on\n", node.c_str());
+            return;
+        }
+        usleep(READY_NODE_POLL * 1000);
+    }
+}
+
+static void notifySocket(const char* path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    size_t len = strlen(path);
+    if (len < 2 || len >= sizeof(addr.sun_path))
+        return;
+    memcpy(addr.sun_path, path, len);
+    if (addr.sun_path[0] == '@')
+        addr.sun_path[0] = '\0'; // abstract namespace
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return;
+    std::string message = "READY=1\nMAINPID=" + std::to_string(getpid()) + "\n";
+    sendto(fd, message.data(), message.size(), MSG_NOSIGNAL, (struct sockaddr*)&addr, offsetof(struct sockaddr_un, sun_path) + len);
+    close(fd);
+}
+
+// Called once the devices we created are usable, or straight away when there are none
+void notifyReady()
+{
+    if (ready_sent)
+        return;
+    ready_sent = true;
+
+    bool wanted = ready_fd >= 0 || daemon_fd >= 0 || ready_file != NULL || SDL_getenv("NOTIFY_SOCKET") != NULL;
+    if (!wanted)
+        return;
+
+    if (uinp_fd >= 0)
+        waitDeviceNode(uinp_fd);
+    if (abs_fd >= 0)
+        waitDeviceNode(abs_fd);
+
+    if (ready_fd >= 0) {
+        const char message[] = "READY=1\n";
+        write(ready_fd, message, sizeof(message) - 1);
+        close(ready_fd);
+        ready_fd = -1;
+    }
+
+    if (ready_file != NULL) {
+        FILE* fp = fopen(ready_file, "w");
+        if (fp != NULL) {
+            fprintf(fp, "%d\n", (int)getpid());
+            fclose(fp);
+        } else {
+            printf("Unable to create %s: %s\n", ready_file, strerror(errno));
+        }
+    }
+
+    if (const char* socket_path = SDL_getenv("NOTIFY_SOCKET")) {
+        notifySocket(socket_path);
+    }
+
+    if (daemon_fd >= 0) {
+        fflush(stdout);
+        write(daemon_fd, "R", 1);
+        close(daemon_fd);
+        daemon_fd = -1;
+    }
+}
+
+void removeReadyFile()
+{
+    if (ready_sent && ready_file != NULL)
+        unlink(ready_file);
+}
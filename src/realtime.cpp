@@ -0,0 +1,165 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb.h"
+
+#include <algorithm>
+#include <malloc.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+// Opt-in tuning for devices where the game keeps every core busy: a realtime scheduling class
+// (or at least a better nice value) for the main loop, pinning it to chosen cores, and locking
+// our memory so the input path never waits on a page fault. All of it applies to the main
+// thread, which is where every event is handled, and is set up right before the main loop,
+// after the game has been started, so the game doesn't inherit any of it.
+
+#define REALTIME_HEAP_RESERVE (1024 * 1024) // heap touched up front for the hot path to allocate from
+#define REALTIME_STACK_RESERVE (64 * 1024)
+
+int realtimePolicy(const char* name)
+{
+    if (strcmp(name, "fifo") == 0)
+        return SCHED_FIFO;
+    if (strcmp(name, "rr") == 0)
+        return SCHED_RR;
+    return -1;
+}
+
+// SCHED_RESET_ON_FORK keeps the class and a negative nice value from leaking into anything we
+// start later, like sudo kill.
+bool setRealtimeScheduling(int policy, int priority, int nice_value)
+{
+    if (policy >= 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = std::max(sched_get_priority_min(policy), std::min(sched_get_priority_max(policy), priority));
+
+        if (sched_setscheduler(0, policy | SCHED_RESET_ON_FORK, &param) == 0) {
+            printf("running with %s priority %d\n", policy == SCHED_FIFO ? "SCHED_FIFO" : "SCHED_RR", param.sched_priority);
+            return true;
+        }
+        printf("Unable to use realtime scheduling (%s), falling back to nice %d\n", strerror(errno), nice_value);
+    }
+
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    sched_setscheduler(0, SCHED_OTHER | SCHED_RESET_ON_FORK, &param);
+
+    if (setpriority(PRIO_PROCESS, 0, nice_value) != 0) {
+        printf("Unable to set nice %d: %s\n", nice_value, strerror(errno));
+        return false;
+    }
+    printf("running with nice %d\n", nice_value);
+    return true;
+}
+
+// "3", "2,3" or "0-1,3"
+bool setCpuAffinity(const char* cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    const char* ch = cpus;
+    while (*ch != '\0') {
+        char* end;
+        long first = strtol(ch, &end, 10);
+        long last = first;
+        if (end == ch)
+            break;
+        if (*end == '-') {
+            ch = end + 1;
+            last = strtol(ch, &end, 10);
+            if (end == ch)
+                break;
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            if (cpu >= 0)
+                CPU_SET(cpu, &set);
+        }
+        ch = (*end == ',' ? end + 1 : end);
+        if (*end != ',' && *end != '\0')
+            break;
+    }
+
+    if (*ch != '\0' || CPU_COUNT(&set) == 0) {
+        printf("Invalid cpu list %s\n", cpus);
+        return false;
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        printf("Unable to pin to cpus %s: %s\n", cpus, strerror(errno));
+        return false;
+    }
+    printf("pinned to cpus %s\n", cpus);
+    return true;
+}
+
+static void __attribute__((noinline)) touchStack()
+{
+    volatile char stack[REALTIME_STACK_RESERVE];
+    for (size_t ii = 0; ii < sizeof(stack); ii += 4096)
+        stack[ii] = 0;
+}
+
+// Touch the stack and a block of heap, keep freed heap in the process instead of handing it
+// back, then lock it all in. Whatever the main loop allocates later (key frames, timers, chord
+// state) comes out of memory that is already resident.
+bool lockMemory()
+{
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    char* heap = (char*)malloc(REALTIME_HEAP_RESERVE);
+    if (heap != NULL) {
+        for (size_t ii = 0; ii < REALTIME_HEAP_RESERVE; ii += 4096)
+            heap[ii] = 0;
+        free(heap);
+    }
+    touchStack();
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        // MCL_FUTURE also has to fit every thread stack created later under RLIMIT_MEMLOCK
+        if (mlockall(MCL_CURRENT) != 0) {
+            printf("Unable to lock memory: %s\n", strerror(errno));
+            return false;
+        }
+    }
+    printf("memory locked\n");
+    return true;
+}
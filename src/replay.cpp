@@ -0,0 +1,221 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb.h"
+
+// Recording and replaying controller input, so mappings can be tried out and compared without
+// the controller. "-record <file>" writes every button, axis, touchpad and gyro event as a line
+// of text, "-replay <file>" feeds such a file back through the normal input handling at the same
+// pace and quits once it has been played. Lines look like:
+//
+//   <ms> button <name> down|up
+//   <ms> axis <name> <value>
+//   <ms> touch down|motion|up <finger> <x> <y>    positions from 0 to 1 across the pad
+//   <ms> gyro <x> <y> <z>                          radians per second
+//   <ms> gyro_rate <hz>
+//
+// where <ms> counts from the start of the recording and names are SDL's ("a", "leftx", ...).
+
+static FILE* record_file = NULL;
+static Uint32 record_start = 0;
+static float record_gyro_rate = 0.0f;
+
+static std::vector<SDL_Event> replay_events;
+static std::vector<Uint32> replay_times;
+static size_t replay_next = 0;
+static Uint32 replay_start = 0;
+
+bool startRecording(const char* path)
+{
+    record_file = fopen(path, "w");
+    if (record_file == NULL) {
+        printf("Unable to record to %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    fprintf(record_file, "# gptokeyb input recording\n");
+    record_start = SDL_GetTicks();
+    return true;
+}
+
+void stopRecording()
+{
+    if (record_file == NULL)
+        return;
+
+    fclose(record_file);
+    record_file = NULL;
+}
+
+void recordInputEvent(const SDL_Event& event)
+{
+    if (record_file == NULL)
+        return;
+
+    Uint32 ms = SDL_GetTicks() - record_start;
+    switch (event.type) {
+    case SDL_CONTROLLERBUTTONDOWN:
+    case SDL_CONTROLLERBUTTONUP:
+        if (const char* name = SDL_GameControllerGetStringForButton((SDL_GameControllerButton)event.cbutton.button))
+            fprintf(record_file, "%u button %s %s\n", ms, name, event.type == SDL_CONTROLLERBUTTONDOWN ? "down" : "up");
+        break;
+
+    case SDL_CONTROLLERAXISMOTION:
+        if (const char* name = SDL_GameControllerGetStringForAxis((SDL_GameControllerAxis)event.caxis.axis))
+            fprintf(record_file, "%u axis %s %d\n", ms, name, event.caxis.value);
+        break;
+
+    case SDL_CONTROLLERTOUCHPADDOWN:
+    case SDL_CONTROLLERTOUCHPADMOTION:
+    case SDL_CONTROLLERTOUCHPADUP:
+        fprintf(record_file, "%u touch %s %d %.4f %.4f\n", ms,
+            event.type == SDL_CONTROLLERTOUCHPADDOWN ? "down" : (event.type == SDL_CONTROLLERTOUCHPADUP ? "up" : "motion"),
+            event.ctouchpad.finger, event.ctouchpad.x, event.ctouchpad.y);
+        break;
+
+    case SDL_CONTROLLERSENSORUPDATE:
+        if (event.csensor.sensor != SDL_SENSOR_GYRO)
+            break;
+        if (gyroRate() != record_gyro_rate) {
+            record_gyro_rate = gyroRate();
+            fprintf(record_file, "%u gyro_rate %g\n", ms, record_gyro_rate);
+        }
+        fprintf(record_file, "%u gyro %.6f %.6f %.6f\n", ms, event.csensor.data[0], event.csensor.data[1], event.csensor.data[2]);
+        break;
+    }
+}
+
+static Uint32 replayCallback(Uint32, void*)
+{
+    Uint32 elapsed = SDL_GetTicks() - replay_start;
+
+    while (replay_next < replay_events.size() && replay_times[replay_next] <= elapsed) {
+        SDL_Event& event = replay_events[replay_next++];
+
+        if (event.type == SDL_USEREVENT) {
+            setGyroRate(event.user.code);
+        } else {
+            event.common.timestamp = replay_start + replay_times[replay_next - 1];
+            handleInputEvent(event);
+        }
+    }
+
+    if (replay_next < replay_events.size())
+        return replay_times[replay_next] - elapsed;
+
+    printf("replay finished\n");
+    SDL_Event quit;
+    memset(&quit, 0, sizeof(quit));
+    quit.type = SDL_QUIT;
+    SDL_PushEvent(&quit);
+    return 0;
+}
+
+bool startReplay(const char* path)
+{
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("Unable to replay %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    char line[256];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line_number++;
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        SDL_Event event;
+        memset(&event, 0, sizeof(event));
+        char kind[32], name[32];
+        unsigned int ms;
+        int value;
+        float rate;
+
+        if (sscanf(line, "%u %31s", &ms, kind) != 2) {
+            printf("ignoring replay line %d\n", line_number);
+            continue;
+        }
+
+        if (strcmp(kind, "button") == 0 && sscanf(line, "%*u %*s %31s %31s", name, kind) == 2) {
+            SDL_GameControllerButton button = SDL_GameControllerGetButtonFromString(name);
+            if (button != SDL_CONTROLLER_BUTTON_INVALID) {
+                event.type = (strcmp(kind, "down") == 0 ? SDL_CONTROLLERBUTTONDOWN : SDL_CONTROLLERBUTTONUP);
+                event.cbutton.button = button;
+                event.cbutton.state = (event.type == SDL_CONTROLLERBUTTONDOWN ? SDL_PRESSED : SDL_RELEASED);
+            }
+        } else if (strcmp(kind, "axis") == 0 && sscanf(line, "%*u %*s %31s %d", name, &value) == 2) {
+            SDL_GameControllerAxis axis = SDL_GameControllerGetAxisFromString(name);
+            if (axis != SDL_CONTROLLER_AXIS_INVALID) {
+                event.type = SDL_CONTROLLERAXISMOTION;
+                event.caxis.axis = axis;
+                event.caxis.value = (Sint16)value;
+            }
+        } else if (strcmp(kind, "touch") == 0 && sscanf(line, "%*u %*s %31s %d %f %f", name, &value, &event.ctouchpad.x, &event.ctouchpad.y) == 4) {
+            if (strcmp(name, "down") == 0)
+                event.type = SDL_CONTROLLERTOUCHPADDOWN;
+            else if (strcmp(name, "motion") == 0)
+                event.type = SDL_CONTROLLERTOUCHPADMOTION;
+            else if (strcmp(name, "up") == 0)
+                event.type = SDL_CONTROLLERTOUCHPADUP;
+            event.ctouchpad.finger = value;
+        } else if (strcmp(kind, "gyro") == 0) {
+            event.type = SDL_CONTROLLERSENSORUPDATE;
+            event.csensor.sensor = SDL_SENSOR_GYRO;
+            if (sscanf(line, "%*u %*s %f %f %f", &event.csensor.data[0], &event.csensor.data[1], &event.csensor.data[2]) != 3)
+                event.type = 0;
+        } else if (strcmp(kind, "gyro_rate") == 0 && sscanf(line, "%*u %*s %f", &rate) == 1) {
+            event.type = SDL_USEREVENT; // applied when its turn comes rather than handled as input
+            event.user.code = (Sint32)rate;
+        }
+
+        if (event.type == 0) {
+            printf("ignoring replay line %d\n", line_number);
+            continue;
+        }
+        replay_events.push_back(event);
+        replay_times.push_back(ms);
+    }
+    fclose(fp);
+
+    printf("replaying %zu events from %s\n", replay_events.size(), path);
+    replay_start = SDL_GetTicks();
+    replay_next = 0;
+    addLoopTimer(replay_events.empty() ? 1 : replay_times[0], replayCallback, NULL);
+    return true;
+}
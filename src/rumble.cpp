@@ -0,0 +1,154 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb.h"
+
+// Rumble passthrough for the fake Xbox 360 pad. The kernel hands force feedback requests from the
+// game to us over the uinput fd: effect uploads and erases, which have to be answered with
+// UI_BEGIN/END_FF_UPLOAD and _ERASE, and EV_FF events starting or stopping an effect. The fd is
+// watched from the main loop, and rumble effects are played on the real controller with
+// SDL_GameControllerRumble. Effects are kept in a table indexed by the id the kernel gave them,
+// which is always below ff_effects_max, so playing one is a single lookup.
+
+#define RUMBLE_MAX_DURATION 0xFFFF // SDL's limit; effects with no length play until they're stopped
+
+static ff_effect rumble_effects[RUMBLE_EFFECTS_MAX];
+static bool rumble_uploaded[RUMBLE_EFFECTS_MAX];
+static Uint32 rumble_gain = 0xFFFF;
+static SDL_GameController* rumble_controller = NULL;
+
+void rumbleControllerAdded(SDL_GameController* controller)
+{
+    rumble_controller = controller;
+}
+
+void rumbleControllerRemoved(SDL_GameController* controller)
+{
+    if (controller == rumble_controller)
+        rumble_controller = NULL;
+}
+
+static void rumbleUpload(int fd, int request_id)
+{
+    struct uinput_ff_upload upload;
+    memset(&upload, 0, sizeof(upload));
+    upload.request_id = request_id;
+
+    if (ioctl(fd, UI_BEGIN_FF_UPLOAD, &upload) < 0) {
+        printf("UI_BEGIN_FF_UPLOAD failed: %s\n", strerror(errno));
+        return;
+    }
+
+    int id = upload.effect.id;
+    if (id < 0 || id >= RUMBLE_EFFECTS_MAX || upload.effect.type != FF_RUMBLE) {
+        upload.retval = -EINVAL;
+    } else {
+        rumble_effects[id] = upload.effect;
+        rumble_uploaded[id] = true;
+        upload.retval = 0;
+    }
+    ioctl(fd, UI_END_FF_UPLOAD, &upload);
+}
+
+static void rumbleErase(int fd, int request_id)
+{
+    struct uinput_ff_erase erase;
+    memset(&erase, 0, sizeof(erase));
+    erase.request_id = request_id;
+
+    if (ioctl(fd, UI_BEGIN_FF_ERASE, &erase) < 0) {
+        printf("UI_BEGIN_FF_ERASE failed: %s\n", strerror(errno));
+        return;
+    }
+
+    if (erase.effect_id < RUMBLE_EFFECTS_MAX)
+        rumble_uploaded[erase.effect_id] = false;
+    erase.retval = 0;
+    ioctl(fd, UI_END_FF_ERASE, &erase);
+}
+
+static void rumblePlay(int id, int count)
+{
+    if (rumble_controller == NULL || id < 0 || id >= RUMBLE_EFFECTS_MAX || !rumble_uploaded[id])
+        return;
+
+    if (count <= 0) {
+        SDL_GameControllerRumble(rumble_controller, 0, 0, 0);
+        return;
+    }
+
+    const ff_rumble_effect& rumble = rumble_effects[id].u.rumble;
+    Uint32 duration = rumble_effects[id].replay.length * (Uint32)count;
+    if (duration == 0 || duration > RUMBLE_MAX_DURATION)
+        duration = RUMBLE_MAX_DURATION;
+
+    SDL_GameControllerRumble(rumble_controller,
+        (Uint16)(rumble.strong_magnitude * rumble_gain / 0xFFFF),
+        (Uint16)(rumble.weak_magnitude * rumble_gain / 0xFFFF),
+        duration);
+}
+
+void handleRumbleEvent(int fd, const struct input_event& ev)
+{
+    if (ev.type == EV_UINPUT) {
+        if (ev.code == UI_FF_UPLOAD)
+            rumbleUpload(fd, ev.value);
+        else if (ev.code == UI_FF_ERASE)
+            rumbleErase(fd, ev.value);
+    } else if (ev.type == EV_FF) {
+        if (ev.code == FF_GAIN)
+            rumble_gain = (Uint32)ev.value & 0xFFFF;
+        else
+            rumblePlay(ev.code, ev.value);
+    }
+}
+
+static bool rumbleCallback(int fd, void*)
+{
+    struct input_event ev;
+
+    while (read(fd, &ev, sizeof(ev)) == sizeof(ev)) {
+        handleRumbleEvent(fd, ev);
+    }
+    return true;
+}
+
+void startRumble(int fd)
+{
+    addLoopWatch(fd, rumbleCallback, NULL);
+}
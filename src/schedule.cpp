@@ -0,0 +1,430 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+#include "gptokeyb.h"
+
+#include <algorithm>
+#include <deque>
+#include <list>
+#include <poll.h>
+
+// Timers and timed key output that run on the main loop, so nothing here needs locking
+// and the event loop never has to sleep in SDL_Delay while output is pending.
+
+struct loop_timer
+{
+    int id;
+    Uint32 due;
+    Uint32 interval;
+    LoopTimerCallback callback;
+    void* param;
+};
+
+#define STEP_START       (1 << 0)
+#define STEP_COLLAPSIBLE (1 << 1)
+
+struct queued_frame
+{
+    key_frame frame;
+    int step_flags;
+};
+
+struct output_stream
+{
+    int tag;
+    Uint32 last_tick = 0; // when the previous frame of this stream was emitted
+    std::deque<queued_frame> frames;
+};
+
+struct loop_watch
+{
+    int id;
+    int fd;
+    bool armed; // cleared while the main loop hasn't handled the last wakeup yet
+    LoopWatchCallback callback;
+    void* param;
+};
+
+static std::vector<loop_timer> loop_timers;
+static int loop_timer_next_id = 1;
+static std::list<output_stream> output_streams;
+
+static inline Sint32 ticksUntil(Uint32 due, Uint32 now)
+{
+    return (Sint32)(due - now);
+}
+
+int addLoopTimer(Uint32 delay, LoopTimerCallback callback, void* param)
+{
+    loop_timer timer;
+    timer.id = loop_timer_next_id++;
+    timer.due = SDL_GetTicks() + delay;
+    timer.interval = delay;
+    timer.callback = callback;
+    timer.param = param;
+    loop_timers.push_back(timer);
+    return timer.id;
+}
+
+void removeLoopTimer(int id)
+{
+    for (auto it = loop_timers.begin(); it != loop_timers.end(); ++it) {
+        if (it->id == id) {
+            loop_timers.erase(it);
+            return;
+        }
+    }
+}
+
+static output_stream& findOutputStream(int tag)
+{
+    if (tag != STREAM_MACRO) { // every macro playback gets a stream of its own so they can overlap
+        for (auto& stream : output_streams) {
+            if (stream.tag == tag)
+                return stream;
+        }
+    }
+    output_streams.emplace_back();
+    output_streams.back().tag = tag;
+    return output_streams.back();
+}
+
+// Drop whole steps at the tail of the stream that haven't started yet and are marked as
+// collapsible, e.g. interactive text input replacing the same character over and over.
+static void collapseOutputStream(output_stream& stream)
+{
+    while (!stream.frames.empty()) {
+        auto start = stream.frames.end();
+        do {
+            --start;
+        } while (start != stream.frames.begin() && !(start->step_flags & STEP_START));
+
+        if ((start->step_flags & (STEP_START | STEP_COLLAPSIBLE)) != (STEP_START | STEP_COLLAPSIBLE))
+            break;
+        stream.frames.erase(start, stream.frames.end());
+    }
+}
+
+void queueKeyFrames(const std::vector<key_frame>& frames, int tag, bool collapsible)
+{
+    if (frames.empty())
+        return;
+
+    output_stream& stream = findOutputStream(tag);
+    if (collapsible)
+        collapseOutputStream(stream);
+
+    for (size_t ii = 0; ii < frames.size(); ii++) {
+        queued_frame queued;
+        queued.frame = frames[ii];
+        queued.step_flags = 0;
+        if (ii == 0)
+            queued.step_flags = STEP_START | (collapsible ? STEP_COLLAPSIBLE : 0);
+        stream.frames.push_back(queued);
+    }
+}
+
+// Drop the frames that haven't been sent yet, releasing any key whose release was among them
+void clearKeyFrames(int tag)
+{
+    for (auto& stream : output_streams) {
+        if (stream.tag != tag || stream.frames.empty())
+            continue;
+
+        key_frame release;
+        std::vector<short> pressed;
+        for (const auto& queued : stream.frames) {
+            for (int ii = 0; ii < queued.frame.count; ii++) {
+                short code = queued.frame.code[ii];
+                if (queued.frame.is_pressed[ii]) {
+                    pressed.push_back(code);
+                } else if (std::find(pressed.begin(), pressed.end(), code) == pressed.end() && isKeyHeld(code)) {
+                    keyFrameAdd(release, code, false);
+                }
+            }
+        }
+        stream.frames.clear();
+        emitKeyFrame(release);
+    }
+}
+
+bool keyFramesPending(int tag)
+{
+    for (const auto& stream : output_streams) {
+        if (stream.tag == tag && !stream.frames.empty())
+            return true;
+    }
+    return false;
+}
+
+// Milliseconds until the next timer or queued frame is due, or -1 if there is nothing to wait for
+int loopTimeout()
+{
+    Uint32 now = SDL_GetTicks();
+    bool found = false;
+    Sint32 timeout = 0;
+
+    for (const auto& timer : loop_timers) {
+        Sint32 wait = ticksUntil(timer.due, now);
+        if (!found || wait < timeout)
+            timeout = wait;
+        found = true;
+    }
+    for (const auto& stream : output_streams) {
+        if (stream.frames.empty())
+            continue;
+        Sint32 wait = ticksUntil(stream.last_tick + stream.frames.front().frame.delay, now);
+        if (!found || wait < timeout)
+            timeout = wait;
+        found = true;
+    }
+
+    if (!found)
+        return -1;
+    return timeout > 0 ? timeout : 0;
+}
+
+void runLoopTimers()
+{
+    Uint32 now = SDL_GetTicks();
+
+    // callbacks may add or remove timers, so look each due one up again by id
+    std::vector<int> due_ids;
+    for (const auto& timer : loop_timers) {
+        if (ticksUntil(timer.due, now) <= 0)
+            due_ids.push_back(timer.id);
+    }
+    for (int id : due_ids) {
+        for (size_t ii = 0; ii < loop_timers.size(); ii++) {
+            if (loop_timers[ii].id != id)
+                continue;
+
+            TRACE(TRACE_TIMER, id, 0, 0);
+            TRACE_SPAN_BEGIN(TRACE_SPAN_LOOP_TIMER, id);
+            Uint32 interval = loop_timers[ii].callback(loop_timers[ii].interval, loop_timers[ii].param);
+            TRACE_SPAN_END(TRACE_SPAN_LOOP_TIMER);
+            for (size_t jj = 0; jj < loop_timers.size(); jj++) { // the vector may have moved
+                if (loop_timers[jj].id == id) {
+                    if (interval == 0) {
+                        loop_timers.erase(loop_timers.begin() + jj);
+                    } else {
+                        loop_timers[jj].due = now + interval;
+                        loop_timers[jj].interval = interval;
+                    }
+                    break;
+                }
+            }
+            break;
+        }
+    }
+
+    for (auto it = output_streams.begin(); it != output_streams.end();) {
+        output_stream& stream = *it;
+        while (!stream.frames.empty() && ticksUntil(stream.last_tick + stream.frames.front().frame.delay, now) <= 0) {
+            emitKeyFrame(stream.frames.front().frame);
+            stream.frames.pop_front();
+            stream.last_tick = now; // the next frame is timed from this one
+        }
+
+        if (stream.frames.empty() && stream.tag == STREAM_MACRO) {
+            it = output_streams.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// File descriptors can't be waited on through SDL, so a helper thread polls them and wakes
+// the main loop with an SDL event. The callback then runs on the main loop like everything
+// else, and the fd isn't polled again until it has.
+
+static std::vector<loop_watch> loop_watches;
+static int loop_watch_next_id = 1;
+static SDL_mutex* loop_watch_mutex = NULL;
+static int loop_watch_wake[2] = {-1, -1};
+static Uint32 loop_watch_event = (Uint32)-1;
+
+static void wakeLoopWatchThread()
+{
+    char byte = 0;
+    write(loop_watch_wake[1], &byte, 1);
+}
+
+static int loopWatchThread(void*)
+{
+    std::vector<pollfd> fds;
+    std::vector<int> ids;
+
+    while (true) {
+        fds.clear();
+        ids.clear();
+
+        pollfd wake;
+        wake.fd = loop_watch_wake[0];
+        wake.events = POLLIN;
+        wake.revents = 0;
+        fds.push_back(wake);
+        ids.push_back(0);
+
+        SDL_LockMutex(loop_watch_mutex);
+        for (const auto& watch : loop_watches) {
+            if (!watch.armed)
+                continue;
+            pollfd pfd;
+            pfd.fd = watch.fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            fds.push_back(pfd);
+            ids.push_back(watch.id);
+        }
+        SDL_UnlockMutex(loop_watch_mutex);
+
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            printf("poll() failed: %s\n", strerror(errno));
+            return -1;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            char buffer[64];
+            read(loop_watch_wake[0], buffer, sizeof(buffer));
+        }
+
+        SDL_LockMutex(loop_watch_mutex);
+        for (size_t ii = 1; ii < fds.size(); ii++) {
+            if (fds[ii].revents == 0)
+                continue;
+            for (auto& watch : loop_watches) {
+                if (watch.id == ids[ii] && watch.armed) {
+                    SDL_Event event;
+                    SDL_zero(event);
+                    event.type = loop_watch_event;
+                    event.user.code = watch.id;
+                    watch.armed = false;
+                    SDL_PushEvent(&event);
+                }
+            }
+        }
+        SDL_UnlockMutex(loop_watch_mutex);
+    }
+    return 0;
+}
+
+int addLoopWatch(int fd, LoopWatchCallback callback, void* param)
+{
+    if (loop_watch_mutex == NULL) {
+        loop_watch_event = SDL_RegisterEvents(1);
+        loop_watch_mutex = SDL_CreateMutex();
+        if (loop_watch_event == (Uint32)-1 || loop_watch_mutex == NULL || pipe2(loop_watch_wake, O_CLOEXEC | O_NONBLOCK) < 0) {
+            printf("Unable to watch file descriptors: %s\n", SDL_GetError());
+            return 0;
+        }
+        SDL_DetachThread(SDL_CreateThread(loopWatchThread, "loop_watch", NULL));
+    }
+
+    loop_watch watch;
+    SDL_LockMutex(loop_watch_mutex);
+    watch.id = loop_watch_next_id++;
+    watch.fd = fd;
+    watch.armed = true;
+    watch.callback = callback;
+    watch.param = param;
+    loop_watches.push_back(watch);
+    SDL_UnlockMutex(loop_watch_mutex);
+
+    wakeLoopWatchThread();
+    return watch.id;
+}
+
+void removeLoopWatch(int id)
+{
+    if (loop_watch_mutex == NULL)
+        return;
+
+    SDL_LockMutex(loop_watch_mutex);
+    for (auto it = loop_watches.begin(); it != loop_watches.end(); ++it) {
+        if (it->id == id) {
+            loop_watches.erase(it);
+            break;
+        }
+    }
+    SDL_UnlockMutex(loop_watch_mutex);
+
+    wakeLoopWatchThread();
+}
+
+bool handleLoopWatchEvent(const SDL_Event& event)
+{
+    if (loop_watch_mutex == NULL || event.type != loop_watch_event)
+        return false;
+
+    LoopWatchCallback callback = NULL;
+    void* param = NULL;
+    int fd = -1;
+
+    SDL_LockMutex(loop_watch_mutex);
+    for (const auto& watch : loop_watches) {
+        if (watch.id == event.user.code) {
+            callback = watch.callback;
+            param = watch.param;
+            fd = watch.fd;
+        }
+    }
+    SDL_UnlockMutex(loop_watch_mutex);
+
+    if (callback == NULL)
+        return true; // removed since the thread saw it
+
+    bool keep = callback(fd, param);
+
+    SDL_LockMutex(loop_watch_mutex);
+    for (auto it = loop_watches.begin(); it != loop_watches.end(); ++it) {
+        if (it->id == event.user.code) {
+            if (keep) {
+                it->armed = true;
+            } else {
+                loop_watches.erase(it);
+            }
+            break;
+        }
+    }
+    SDL_UnlockMutex(loop_watch_mutex);
+
+    wakeLoopWatchThread();
+    return true;
+}
@@ -0,0 +1,202 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb.h"
+
+#include <time.h>
+
+// Startup is mostly waiting: SDL scanning for controllers, and the kernel working through every
+// UI_SET_*BIT ioctl for the uinput device. Neither needs the other, so the device is set up and
+// created on its own thread while the main thread brings up SDL, reads the profile and loads
+// the controller DB. -profile-startup prints how long each of those took.
+
+#define STARTUP_PHASES_MAX 16
+
+struct startup_phase
+{
+    const char* name;
+    double ms;
+};
+
+static bool startup_profile = false;
+static startup_phase startup_phases[STARTUP_PHASES_MAX];
+static int startup_phase_count = 0;
+static double startup_begin = 0;
+static double startup_last = 0;
+static double startup_exec = -1; // exec to main, only as precise as /proc's clock ticks
+
+static double device_begin = 0; // written by the device thread, read after it is joined
+static double device_end = 0;
+static SDL_Thread* device_thread = NULL;
+
+static double nowMs(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Field 22 of /proc/self/stat is when the process started, in clock ticks since boot.
+static double execToNowMs()
+{
+    char buffer[1024];
+    FILE* fp = fopen("/proc/self/stat", "r");
+    if (fp == NULL)
+        return -1;
+    size_t len = fread(buffer, 1, sizeof(buffer) - 1, fp);
+    fclose(fp);
+    buffer[len] = '\0';
+
+    const char* field = strrchr(buffer, ')'); // the command name may contain spaces
+    unsigned long long start_ticks;
+    if (field == NULL || sscanf(field + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %llu", &start_ticks) != 1)
+        return -1;
+
+    return nowMs(CLOCK_BOOTTIME) - start_ticks * 1000.0 / sysconf(_SC_CLK_TCK);
+}
+
+void startupProfile(bool enable)
+{
+    startup_profile = enable;
+    if (enable) {
+        startup_exec = execToNowMs();
+        if (startup_exec >= 0)
+            startup_exec -= nowMs(CLOCK_MONOTONIC) - startup_begin; // back to when main started
+    }
+}
+
+void startupMark()
+{
+    startup_begin = startup_last = nowMs(CLOCK_MONOTONIC);
+}
+
+// Ends the phase that started at the previous mark
+void startupPhase(const char* name)
+{
+    double now = nowMs(CLOCK_MONOTONIC);
+    if (startup_phase_count < STARTUP_PHASES_MAX) {
+        startup_phases[startup_phase_count].name = name;
+        startup_phases[startup_phase_count].ms = now - startup_last;
+        startup_phase_count++;
+    }
+    startup_last = now;
+}
+
+void startupReport()
+{
+    if (!startup_profile)
+        return;
+
+    printf("startup profile (ms):\n");
+    if (startup_exec >= 0)
+        printf("  %-22s %8.2f (clock tick resolution)\n", "exec to main", startup_exec);
+    for (int i = 0; i < startup_phase_count; i++)
+        printf("  %-22s %8.2f\n", startup_phases[i].name, startup_phases[i].ms);
+    if (device_end > 0)
+        printf("  %-22s %8.2f (own thread, from %.2f)\n", "uinput device", device_end - device_begin, device_begin - startup_begin);
+    printf("  %-22s %8.2f\n", "total", startup_last - startup_begin);
+}
+
+static int createDevice(bool xbox, uinput_user_dev& device)
+{
+    int fd = open("/dev/uinput", O_RDWR | O_NONBLOCK | O_CLOEXEC); // read for force feedback requests
+    if (fd < 0) {
+        printf("Unable to open /dev/uinput\n");
+        return -1;
+    }
+
+    // Intialize the uInput device to NULL
+    memset(&device, 0, sizeof(device));
+    device.id.version = 1;
+    device.id.bustype = BUS_USB;
+
+    if (xbox) {
+        setupFakeXbox360Device(device, fd);
+    } else {
+        setupFakeKeyboardMouseDevice(device, fd);
+    }
+
+    // Create input device into input sub-system
+    if (!createUinputDevice(fd, device)) {
+        printf("Unable to create UINPUT device.\n");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int deviceSetupThread(void*)
+{
+    device_begin = nowMs(CLOCK_MONOTONIC);
+
+    uinp_fd = createDevice(xbox360_mode, uidev);
+    if (uinp_fd < 0)
+        return -1;
+
+    // a daemon keeps the other kind ready too, so a game wanting it doesn't wait for it
+    if (daemon_mode) {
+        uinput_user_dev spare_dev;
+        spare_fd = createDevice(!xbox360_mode, spare_dev);
+        if (spare_fd < 0)
+            return -1;
+    }
+
+    device_end = nowMs(CLOCK_MONOTONIC);
+    return 0;
+}
+
+// Only touches uinp_fd, spare_fd and uidev, which nothing else uses until finishDeviceSetup()
+bool startDeviceSetup()
+{
+    device_thread = SDL_CreateThread(deviceSetupThread, "uinput_setup", NULL);
+    if (device_thread == NULL) {
+        printf("Unable to start the device setup thread: %s\n", SDL_GetError());
+        return deviceSetupThread(NULL) == 0;
+    }
+    return true;
+}
+
+bool finishDeviceSetup()
+{
+    int status = 0;
+    if (device_thread != NULL) {
+        SDL_WaitThread(device_thread, &status);
+        device_thread = NULL;
+    }
+    return status == 0 && uinp_fd >= 0;
+}
@@ -48,6 +48,13 @@ enum DZ_MODE {
     DZ_HYBRID,
 };
 
+enum OUTPUT_STREAM {
+    STREAM_TEXT_PRESET,
+    STREAM_TEXT_INTERACTIVE,
+    STREAM_MACRO,
+    STREAM_KILL, // the Alt+F4 kill mode sends before it kills the app
+};
+
 
 #define GBTN_NONE 0
 
@@ -97,29 +104,98 @@ enum DZ_MODE {
 #define GBTN_CHECK_BTN(BUTTON) (state.button_state & (GBTN_ ## BUTTON))
 #define GBTN_CHECK(BUTTON) (state.button_state & (BUTTON))
 
+#define KEY_FRAME_MAX 8
+
+#define MACRO_CODE_BASE 0x1000 // binding codes from here on play config.macros[code - MACRO_CODE_BASE]
+#define MACRO_MAX 256
+#define COMBO_CODE_BASE 0x1200 // binding codes from here on press config.combos[code - COMBO_CODE_BASE]
+#define COMBO_MAX 256
+#define TAPHOLD_CODE_BASE 0x1400 // binding codes from here on are config.tap_holds[code - TAPHOLD_CODE_BASE]
+#define TAPHOLD_MAX 256
+
+#define RUMBLE_EFFECTS_MAX 16 // force feedback effects a game can upload to the fake Xbox 360 pad
+
+// A group of key changes written to uinput together and closed by a single SYN_REPORT
+struct key_frame
+{
+    Uint32 delay = 0; // milliseconds to wait after the previous frame before emitting this one
+    int count = 0;
+    short code[KEY_FRAME_MAX];
+    bool is_pressed[KEY_FRAME_MAX];
+};
+
+// Keys bound together, e.g. "ctrl+shift+s": pressed in one frame and released in reverse in another
+struct key_combo
+{
+    std::vector<short> keys;
+    key_frame press;
+    key_frame release;
+};
+
+enum CHORD_ACTION {
+    CHORD_KEY,
+    CHORD_KILL,
+    CHORD_TEXT_PRESET,
+    CHORD_TEXT_CONFIRM,
+    CHORD_TEXT_INTERACTIVE,
+};
+
+enum CHORD_RELEASE {
+    CHORD_RELEASE_KEY,  // release the button's own key as usual
+    CHORD_RELEASE_TAP,  // the button's key was held back, so press and release it now
+    CHORD_RELEASE_NONE, // the button was part of a chord, send nothing
+};
+
+struct chord
+{
+    uint buttons = GBTN_NONE;   // every button of the chord
+    uint triggers = GBTN_NONE;  // buttons that complete the chord; the others must already be held
+    bool hotkey = false;        // also needs one of the hotkey buttons (config chords only)
+    CHORD_ACTION action = CHORD_KEY;
+    short code = 0;
+    short modifier = 0;
+};
+
+struct tap_hold
+{
+    short tap = 0;
+    short hold = 0;
+    bool eager = false; // hold as soon as another button is pressed
+};
+
+struct tap_hold_state
+{
+    int index = 0;      // into config.tap_holds
+    int timer_id = 0;   // main loop timer deciding on hold, 0 once decided
+    bool holding = false;
+};
+
+struct text_key
+{
+    short code = 0;
+    bool shift = false;
+};
+
 struct GptokeybState
 {
-    int hotkey_jsdevice;
-    int start_jsdevice;
-    int textinputinteractivetrigger_jsdevice; // to trigger text input interactive
-    int textinputpresettrigger_jsdevice; // to trigger text input preset
-    int textinputconfirmtrigger_jsdevice; // to trigger text input confirm via Enter key
     int mouseX = 0;
     int mouseY = 0;
+    int scrollX = 0;
+    int scrollY = 0;
+    int wheel_remainder = 0;  // high resolution wheel movement short of a whole notch
+    int hwheel_remainder = 0;
+    int abs_x = -1;           // last position sent on the absolute pointer device, -1 if none yet
+    int abs_y = -1;
+    int abs_anchor_x = 0;     // where the pointer was when the absolute stick left the centre
+    int abs_anchor_y = 0;
+    bool abs_stick_active = false;
     int current_left_analog_x = 0;
     int current_left_analog_y = 0;
     int current_right_analog_x = 0;
     int current_right_analog_y = 0;
     int current_l2 = 0;
     int current_r2 = 0;
-    bool hotkey_pressed = false; // current state of hotkey
-    bool hotkey_was_pressed = false; // indicates hotkey button has been pressed, and key may need to be processed on button's release, if hotkey combo isn't triggered
-    bool start_pressed = false;
-    bool start_was_pressed = false; // indicates start button has been pressed, and key may need to be processed on button's release, if start combo isn't triggered
     bool textinputinteractive_mode_active = false;
-    bool textinputinteractivetrigger_pressed = false;
-    bool textinputpresettrigger_pressed = false;
-    bool textinputconfirmtrigger_pressed = false;
     bool left_analog_was_up = false;
     bool left_analog_was_down = false;
     bool left_analog_was_left = false;
@@ -128,24 +204,46 @@ struct GptokeybState
     bool right_analog_was_down = false;
     bool right_analog_was_left = false;
     bool right_analog_was_right = false;
-    bool a_hk_was_pressed = false;
-    bool b_hk_was_pressed = false;
-    bool x_hk_was_pressed = false;
-    bool y_hk_was_pressed = false;
-    bool l1_hk_was_pressed = false;
-    bool r1_hk_was_pressed = false;
-    bool l2_was_pressed = false;
-    bool l2_hk_was_pressed = false;
-    bool r2_was_pressed = false;
-    bool r2_hk_was_pressed = false;
-    bool hotkey_combo_triggered = false; //keep track of whether a hotkey combo was pressed; if so, don't send hotkey key when hotkey is released
-    bool start_combo_triggered = false; //keep track of whether a start combo was pressed; if so, don't send start key when start is released
+    Uint32 left_analog_since_up = 0; // when each stick direction key was pressed, for min_hold
+    Uint32 left_analog_since_down = 0;
+    Uint32 left_analog_since_left = 0;
+    Uint32 left_analog_since_right = 0;
+    Uint32 right_analog_since_up = 0;
+    Uint32 right_analog_since_down = 0;
+    Uint32 right_analog_since_left = 0;
+    Uint32 right_analog_since_right = 0;
+    int analog_hold_timer_id = 0;
+    int left_analog_sector = -1;  // direction picked in the sector mode, -1 for none
+    int right_analog_sector = -1;
+    Uint32 analog_hold_due = 0;
     short key_to_repeat = 0;
     uint button_state = GBTN_NONE;
-    SDL_TimerID key_repeat_timer_id = 0;
+    SDL_JoystickID input_controller = -1; // the controller that last sent a button, axis or touch, so what is held came from it
+    uint chord_pending = GBTN_NONE;  // deferred buttons whose key hasn't been sent yet
+    uint chord_consumed = GBTN_NONE; // buttons that completed a chord, ignored until released
+    std::vector<chord> active_chords;
+    std::vector<tap_hold_state> tap_holds; // tap/hold buttons that are down
+    int key_repeat_timer_id = 0;
+    int input_repeat_timer_id = 0; // main loop timer for interactive text input repeat
+    float gyro_x = 0.0f; // pointer movement from the gyro not sent yet, including fractions
+    float gyro_y = 0.0f;
+    float gyro_smooth_x = 0.0f; // running average of the slow gyro movement, in degrees per second
+    float gyro_smooth_y = 0.0f;
+    float touch_move_x = 0.0f; // touchpad finger movement since the last mouse tick, in pad widths
+    float touch_move_y = 0.0f;
+    float touch_x = 0.0f;      // pointer movement from the touchpad not sent yet, including fractions
+    float touch_y = 0.0f;
+    float touch_scroll_x = 0.0f; // in 1/120ths of a wheel notch
+    float touch_scroll_y = 0.0f;
 };
 
 
+struct config_option
+{
+    char key[CONFIG_ARG_MAX_BYTES];
+    char value[CONFIG_ARG_MAX_BYTES];
+};
+
 struct GptokeybConfig
 {
     short back = KEY_ESC;
@@ -218,6 +316,10 @@ struct GptokeybConfig
 
     bool left_analog_as_mouse = false;
     bool right_analog_as_mouse = false;
+    bool left_analog_as_scroll = false;
+    bool right_analog_as_scroll = false;
+    bool left_analog_as_absolute = false;
+    bool right_analog_as_absolute = false;
     bool dpad_as_mouse = false;
 
     short left_analog_up = KEY_W;
@@ -248,6 +350,23 @@ struct GptokeybConfig
     int mouse_slow_scale = 50;
     uint mouse_slow_button = GBTN_NONE;
 
+    bool gyro_mouse = false;
+    int gyro_scale_x = 10;    // pointer units per degree turned
+    int gyro_scale_y = 10;
+    int gyro_deadband = 1;    // degrees per second ignored as noise
+    int gyro_smoothing = 0;   // turns slower than this many degrees per second are smoothed
+    uint gyro_ratchet_button = GBTN_NONE;
+
+    bool touchpad_mouse = false;
+    bool touchpad_absolute = false; // the pointer goes where the finger is on the pad
+    int touchpad_scale_x = 800;  // pointer units for a finger moved across the whole pad
+    int touchpad_scale_y = 400;
+    int touchpad_accel = 50;     // extra speed, in percent, per pad width per second the finger moves
+    int touchpad_scroll = 10;    // wheel notches for two fingers moved over the whole pad
+    Uint32 touchpad_tap_delay = 180; // longest touch that still counts as a tap
+    short touchpad_tap = BTN_LEFT;
+    short touchpad_tap2 = BTN_RIGHT; // tapping with two fingers
+
     DZ_MODE deadzone_mode = DZ_DEFAULT;
     int deadzone_scale = 512;
     int dpad_mouse_step = 5;
@@ -255,21 +374,85 @@ struct GptokeybConfig
     int deadzone_y = 15000;
     int deadzone_x = 15000;
     int deadzone_triggers = 3000;
+    int left_analog_press = 0;    // how far a stick goes before its direction key is pressed, 0 for deadzone
+    int left_analog_release = 0;  // and how far back before it is let go, 0 for the same as press
+    int right_analog_press = 0;
+    int right_analog_release = 0;
+    Uint32 left_analog_min_hold = 0; // ms a stick direction key stays down at least
+    Uint32 right_analog_min_hold = 0;
+    int left_analog_ways = 0;     // 4 or 8 for keys picked by the stick's angle, 0 for each axis on its own
+    int right_analog_ways = 0;
+    int analog_diagonal = 45;     // degrees each diagonal covers with 8 ways
+    int analog_overlap = 8;       // degrees the stick has to go past a direction's edge to leave it
+    Uint32 left_analog_pulse = 0; // ms period of the proportional key pulses, 0 to just hold the key
+    Uint32 right_analog_pulse = 0;
+    int analog_pulse_min = 20;    // percent of the period the key is held just past the press threshold
 
     int fake_mouse_scale = 512;
     int fake_mouse_delay = 16;
+    int wheel_scale = 2; // 1/120ths of a wheel notch per tick for each unit a stick would move the mouse
+
+    int absolute_width = 1280;  // range of the absolute pointer device, fixed once it is created
+    int absolute_height = 720;
+    bool absolute_window = false; // sticks move the pointer around where it was instead of over the whole screen
+    int absolute_radius = 200;
+    bool absolute_recenter = true; // the pointer goes back when the stick is let go
 
     Uint32 key_repeat_interval = SDL_DEFAULT_REPEAT_INTERVAL * 2; 
     Uint32 key_repeat_delay = SDL_DEFAULT_REPEAT_DELAY; 
 
     char* text_input_preset;
+    Uint32 text_input_delay = 16; // gap between text input frames, 0 sends them back to back
+
+    Uint32 macro_delay = 16; // gap between macro frames
+    std::vector<std::string> macro_text;
+    std::vector<std::vector<key_frame>> macros;
+
+    std::vector<key_combo> combos; // bindings of more than one key
+    std::vector<config_option> added_modifiers; // add_alt and friends, applied by finishConfig once every key is known
+
+    std::vector<chord> chords; // "start+a = f5" style entries
+
+    Uint32 tap_hold_delay = 200; // how long a tap/hold button has to be held to act as its hold key
+    std::vector<tap_hold> tap_holds;
+
+    Uint32 kill_timeout = 3000; // how long kill mode waits for the app to exit before killing it
+    Uint32 drain_delay = 50;    // time the game gets to read our last events before the device is destroyed
+
+    Uint32 metrics_interval = 10000; // how often the metrics file is rewritten
 };
 
 
-struct config_option
+enum METRIC_INPUT {
+    METRIC_IN_BUTTON,
+    METRIC_IN_AXIS,
+    METRIC_IN_DEVICE,
+    METRIC_IN_OTHER,
+    METRIC_IN_COUNT,
+};
+
+#define LATENCY_BUCKETS 32
+
+// Log2 histogram of durations in microseconds, bucket n counts durations below 2^n us
+struct latency_histogram
 {
-    char key[CONFIG_ARG_MAX_BYTES];
-    char value[CONFIG_ARG_MAX_BYTES];
+    Uint64 bucket[LATENCY_BUCKETS] = {};
+    Uint64 count = 0;
+    Uint64 sum_us = 0;
+};
+
+struct GptokeybMetrics
+{
+    Uint64 events_in[METRIC_IN_COUNT] = {};
+    Uint64 events_out[EV_CNT] = {};
+    Uint64 uinput_writes = 0;
+    Uint64 uinput_bytes = 0;
+    Uint64 uinput_dropped = 0;  // writes the kernel refused or cut short
+    Uint64 repeat_ticks = 0;
+    Uint64 mouse_ticks = 0;
+    Uint64 text_chars = 0;
+    latency_histogram input_handling; // time spent handling one SDL event
+    latency_histogram input_queue;    // time from SDL queuing an event to us handling it
 };
 
 #endif /* __STRUCTS_H__ */
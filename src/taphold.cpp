@@ -0,0 +1,171 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+#include "gptokeyb.h"
+
+// Dual role bindings, e.g. "l1 = tap:tab hold:leftshift". A press that is released within
+// tap_hold_delay milliseconds sends the tap key; one held longer presses the hold key until it
+// is released. With "eager" the hold key is pressed as soon as another button is pressed, so
+// holding l1 and pressing a sends shift+a without waiting for the delay.
+//
+// Like macros, each binding gets a code above KEY_MAX, and emitKey hands those codes to
+// tapHoldKey. The decision is made by a main loop timer, so it is never later than one pass of
+// the loop after the delay.
+
+static short tapHoldBindingCode(const std::string& value)
+{
+    if (value.compare(0, 6, "macro:") == 0)
+        return addConfigMacro(value.c_str() + 6);
+    return configKeyCode(value.c_str());
+}
+
+// Returns the code to bind, or 0 if the value doesn't parse
+short addConfigTapHold(const char* value)
+{
+    std::istringstream input(value);
+    std::string word;
+    tap_hold entry;
+
+    while (input >> word) {
+        if (word.compare(0, 4, "tap:") == 0) {
+            entry.tap = tapHoldBindingCode(word.substr(4));
+        } else if (word.compare(0, 5, "hold:") == 0) {
+            entry.hold = tapHoldBindingCode(word.substr(5));
+        } else if (word == "eager") {
+            entry.eager = true;
+        } else {
+            printf("unknown tap/hold option '%s'\n", word.c_str());
+            return 0;
+        }
+    }
+    if (entry.tap == 0 || entry.hold == 0 || (entry.hold >= MACRO_CODE_BASE && entry.hold < COMBO_CODE_BASE)) {
+        printf("tap/hold needs a tap key and a hold key: %s\n", value);
+        return 0;
+    }
+    if (config.tap_holds.size() >= TAPHOLD_MAX) {
+        printf("too many tap/hold bindings, ignoring %s\n", value);
+        return 0;
+    }
+
+    config.tap_holds.push_back(entry);
+    return TAPHOLD_CODE_BASE + config.tap_holds.size() - 1;
+}
+
+static tap_hold_state* findTapHoldState(int index)
+{
+    for (auto& held : state.tap_holds) {
+        if (held.index == index)
+            return &held;
+    }
+    return NULL;
+}
+
+static void commitTapHold(tap_hold_state& held)
+{
+    if (held.timer_id != 0) {
+        removeLoopTimer(held.timer_id);
+        held.timer_id = 0;
+    }
+    held.holding = true;
+    emitKey(config.tap_holds[held.index].hold, true);
+}
+
+static Uint32 tapHoldTimerCallback(Uint32, void* param)
+{
+    tap_hold_state* held = findTapHoldState((int)(intptr_t)param);
+    if (held != NULL && !held->holding) {
+        held->timer_id = 0; // the timer goes away when we return 0
+        commitTapHold(*held);
+    }
+    return 0;
+}
+
+void tapHoldKey(int code, bool is_pressed)
+{
+    int index = code - TAPHOLD_CODE_BASE;
+    if (index < 0 || index >= (int)config.tap_holds.size())
+        return;
+
+    tap_hold_state* held = findTapHoldState(index);
+    if (is_pressed) {
+        if (held != NULL)
+            return; // bound to two buttons that are both down
+
+        tap_hold_state pressed;
+        pressed.index = index;
+        pressed.timer_id = addLoopTimer(config.tap_hold_delay, tapHoldTimerCallback, (void*)(intptr_t)index);
+        state.tap_holds.push_back(pressed);
+        return;
+    }
+
+    if (held == NULL)
+        return;
+    if (held->holding) {
+        emitKey(config.tap_holds[index].hold, false);
+    } else {
+        removeLoopTimer(held->timer_id);
+        queueKeyTap(config.tap_holds[index].tap, 0, 16);
+    }
+    state.tap_holds.erase(state.tap_holds.begin() + (held - &state.tap_holds[0]));
+}
+
+// Another button was pressed: eager bindings that are still undecided become holds
+void tapHoldOtherPressed()
+{
+    for (auto& held : state.tap_holds) {
+        if (!held.holding && config.tap_holds[held.index].eager)
+            commitTapHold(held);
+    }
+}
+
+// The tap key, for when a tap/hold button has to be tapped on its own
+short tapHoldTapCode(int code)
+{
+    int index = code - TAPHOLD_CODE_BASE;
+    if (index < 0 || index >= (int)config.tap_holds.size())
+        return 0;
+    return config.tap_holds[index].tap;
+}
+
+void resetTapHolds()
+{
+    for (auto& held : state.tap_holds) {
+        if (held.timer_id != 0)
+            removeLoopTimer(held.timer_id);
+    }
+    state.tap_holds.clear();
+}
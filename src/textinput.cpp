@@ -0,0 +1,148 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+#include "gptokeyb.h"
+
+#include <ctype.h>
+
+static text_key text_keys[128]; // ASCII to keycode, plus whether shift is needed
+
+void initialiseTextKeys()
+{
+    const char* shifted_symbols = "~!@#$%^&*()_+{}|:\"<>?";
+    char str[2] = {0, 0};
+
+    for (int ii = 0; ii < 128; ii++) {
+        if (!isprint(ii))
+            continue;
+
+        str[0] = (char)tolower(ii);
+        text_keys[ii].code = char_to_keycode(str);
+        text_keys[ii].shift = isupper(ii) || (strchr(shifted_symbols, ii) != NULL);
+    }
+
+    text_keys[(int)' '].code = KEY_SPACE;
+    text_keys[(int)'\t'].code = KEY_TAB;
+    text_keys[(int)'\n'].code = KEY_ENTER;
+}
+
+void keyFrameAdd(key_frame& frame, short code, bool is_pressed)
+{
+    if (frame.count < KEY_FRAME_MAX) {
+        frame.code[frame.count] = code;
+        frame.is_pressed[frame.count] = is_pressed;
+        frame.count++;
+    }
+}
+
+// Each key is a press frame followed by a release frame. Shift is pressed together with the
+// first key of a run that needs it and only released together with the last one, so "AB"
+// doesn't bounce shift between the two letters.
+void addTextInputFrames(std::vector<key_frame>& frames, short code, bool shift, bool& shift_held, Uint32 delay)
+{
+    key_frame press;
+    press.delay = delay;
+    metrics.text_chars++;
+    if (shift && !shift_held) {
+        keyFrameAdd(press, KEY_LEFTSHIFT, true);
+    } else if (!shift && shift_held) {
+        keyFrameAdd(press, KEY_LEFTSHIFT, false);
+    }
+    shift_held = shift;
+    keyFrameAdd(press, code, true);
+    frames.push_back(press);
+
+    key_frame release;
+    release.delay = delay;
+    keyFrameAdd(release, code, false);
+    frames.push_back(release);
+}
+
+void finishTextInputFrames(std::vector<key_frame>& frames, bool& shift_held)
+{
+    if (shift_held && !frames.empty()) {
+        keyFrameAdd(frames.back(), KEY_LEFTSHIFT, false);
+    }
+    shift_held = false;
+}
+
+void buildTextInputFrames(std::vector<key_frame>& frames, const char* text, Uint32 delay)
+{
+    bool shift_held = false;
+
+    frames.clear();
+    frames.reserve(strlen(text) * 2);
+    for (const char* ch = text; *ch != '\0'; ch++) {
+        unsigned char ii = (unsigned char)(*ch);
+        if (ii >= 128 || text_keys[ii].code == 0)
+            continue; // no key for this character
+
+        addTextInputFrames(frames, text_keys[ii].code, text_keys[ii].shift, shift_held, delay);
+    }
+    finishTextInputFrames(frames, shift_held);
+}
+
+void processKeys()
+{
+    std::vector<key_frame> frames;
+
+    buildTextInputFrames(frames, config.text_input_preset, config.text_input_delay);
+    queueKeyFrames(frames, STREAM_TEXT_PRESET, false);
+}
+
+void queueTextInputKey(int code, bool uppercase)
+{
+    std::vector<key_frame> frames;
+    bool shift_held = false;
+
+    addTextInputFrames(frames, code, uppercase, shift_held, config.text_input_delay);
+    finishTextInputFrames(frames, shift_held);
+    queueKeyFrames(frames, STREAM_TEXT_INTERACTIVE, false);
+}
+
+// Backspace and retype as one step; if the user scrolls faster than the step can be sent,
+// the steps that haven't started yet are dropped in favour of the newest one.
+void queueTextInputReplace(int code, bool uppercase)
+{
+    std::vector<key_frame> frames;
+    bool shift_held = false;
+
+    addTextInputFrames(frames, KEY_BACKSPACE, false, shift_held, config.text_input_delay);
+    addTextInputFrames(frames, code, uppercase, shift_held, config.text_input_delay);
+    finishTextInputFrames(frames, shift_held);
+    queueKeyFrames(frames, STREAM_TEXT_INTERACTIVE, true);
+}
@@ -0,0 +1,223 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "gptokeyb.h"
+
+#include <math.h>
+
+// The controller's touchpad as a laptop style trackpad, "touchpad = mouse". One finger moves the
+// pointer, two fingers scroll, and a quick tap clicks (a two finger tap right clicks). SDL reports
+// finger positions from 0 to 1 across the pad, often hundreds of times a second; the movement is
+// only added up here and turned into pointer and wheel units on the next mouse tick, so it goes
+// out as one frame per tick however fast the pad reports.
+//
+// With "touchpad = absolute" the pointer instead goes straight to where the finger is, over the
+// whole screen, on the absolute pointer device; taps still click.
+
+#define TOUCHPAD_FINGERS 2
+#define TOUCHPAD_TAP_TRAVEL 0.03f // how far, in pad widths, fingers may move and still count as a tap
+#define TOUCHPAD_GAIN_MAX 4.0f    // acceleration never makes the pointer more than this much faster
+
+struct touch_finger
+{
+    bool active = false;
+    Sint32 touchpad = 0;
+    Sint32 finger = 0;
+    float x = 0.0f;
+    float y = 0.0f;
+};
+
+static touch_finger touch_fingers[TOUCHPAD_FINGERS];
+static int touch_gesture_fingers = 0; // most fingers down at once since the first one touched
+static float touch_gesture_travel = 0.0f;
+static Uint32 touch_gesture_start = 0;
+
+static touch_finger* findFinger(const SDL_ControllerTouchpadEvent& touch)
+{
+    for (auto& finger : touch_fingers) {
+        if (finger.active && finger.touchpad == touch.touchpad && finger.finger == touch.finger)
+            return &finger;
+    }
+    return NULL;
+}
+
+static int activeFingers()
+{
+    int count = 0;
+    for (const auto& finger : touch_fingers)
+        count += (finger.active ? 1 : 0);
+    return count;
+}
+
+static void touchpadAbsolute(const SDL_ControllerTouchpadEvent& touch)
+{
+    float x = (touch.x < 0.0f ? 0.0f : (touch.x > 1.0f ? 1.0f : touch.x));
+    float y = (touch.y < 0.0f ? 0.0f : (touch.y > 1.0f ? 1.0f : touch.y));
+    emitAbsolutePointer((int)(x * (config.absolute_width - 1)), (int)(y * (config.absolute_height - 1)));
+}
+
+static void touchpadDown(const SDL_ControllerTouchpadEvent& touch)
+{
+    if (activeFingers() == 0) {
+        touch_gesture_fingers = 0;
+        touch_gesture_travel = 0.0f;
+        touch_gesture_start = touch.timestamp;
+    }
+
+    for (auto& finger : touch_fingers) {
+        if (!finger.active) {
+            finger.active = true;
+            finger.touchpad = touch.touchpad;
+            finger.finger = touch.finger;
+            finger.x = touch.x;
+            finger.y = touch.y;
+            break;
+        }
+    }
+
+    int count = activeFingers();
+    if (count > touch_gesture_fingers)
+        touch_gesture_fingers = count;
+    if (config.touchpad_absolute && count == 1)
+        touchpadAbsolute(touch);
+}
+
+static void touchpadMotion(const SDL_ControllerTouchpadEvent& touch)
+{
+    touch_finger* finger = findFinger(touch);
+    if (finger == NULL)
+        return;
+
+    float dx = touch.x - finger->x;
+    float dy = touch.y - finger->y;
+    finger->x = touch.x;
+    finger->y = touch.y;
+    touch_gesture_travel += fabsf(dx) + fabsf(dy);
+
+    int count = activeFingers();
+    if (config.touchpad_absolute) {
+        if (count == 1)
+            touchpadAbsolute(touch);
+    } else if (count == 1) {
+        state.touch_move_x += dx;
+        state.touch_move_y += dy;
+    } else {
+        // both fingers move the content, so each adds half
+        state.touch_scroll_x -= dx / count * config.touchpad_scroll * 120;
+        state.touch_scroll_y += dy / count * config.touchpad_scroll * 120;
+    }
+}
+
+static void touchpadUp(const SDL_ControllerTouchpadEvent& touch)
+{
+    touch_finger* finger = findFinger(touch);
+    if (finger == NULL)
+        return;
+
+    finger->active = false;
+    if (activeFingers() > 0)
+        return;
+
+    // the whole gesture is over, was it a tap?
+    if ((Uint32)(touch.timestamp - touch_gesture_start) <= config.touchpad_tap_delay && touch_gesture_travel <= TOUCHPAD_TAP_TRAVEL) {
+        short code = (touch_gesture_fingers > 1 ? config.touchpad_tap2 : config.touchpad_tap);
+        if (code != 0)
+            queueKeyTap(code, 0, 16);
+    }
+}
+
+void handleTouchpadEvent(const SDL_Event& event)
+{
+    if (!(config.touchpad_mouse || config.touchpad_absolute) || xbox360_mode || state.textinputinteractive_mode_active)
+        return;
+
+    switch (event.type) {
+    case SDL_CONTROLLERTOUCHPADDOWN:
+        touchpadDown(event.ctouchpad);
+        break;
+    case SDL_CONTROLLERTOUCHPADMOTION:
+        touchpadMotion(event.ctouchpad);
+        break;
+    case SDL_CONTROLLERTOUCHPADUP:
+        touchpadUp(event.ctouchpad);
+        break;
+    }
+}
+
+void resetTouchpad()
+{
+    for (auto& finger : touch_fingers)
+        finger.active = false;
+}
+
+bool touchpadMotionPending()
+{
+    return (state.touch_move_x != 0.0f || state.touch_move_y != 0.0f
+        || fabsf(state.touch_scroll_x) >= 1.0f || fabsf(state.touch_scroll_y) >= 1.0f);
+}
+
+// Adds the pointer and wheel movement since the last mouse tick, keeping the fractions; the wheel
+// is in 1/120ths of a notch
+void takeTouchpadMotion(int& x, int& y, int& wheel, int& hwheel)
+{
+    // the faster the finger moved over this tick, the further each bit of it takes the pointer
+    float tick = (config.fake_mouse_delay > 0 ? config.fake_mouse_delay : 1) / 1000.0f;
+    float speed = sqrtf(state.touch_move_x * state.touch_move_x + state.touch_move_y * state.touch_move_y) / tick;
+    float gain = 1.0f + speed * config.touchpad_accel / 100.0f;
+    if (gain > TOUCHPAD_GAIN_MAX)
+        gain = TOUCHPAD_GAIN_MAX;
+
+    state.touch_x += state.touch_move_x * config.touchpad_scale_x * gain;
+    state.touch_y += state.touch_move_y * config.touchpad_scale_y * gain;
+    state.touch_move_x = 0.0f;
+    state.touch_move_y = 0.0f;
+
+    int move_x = (int)state.touch_x;
+    int move_y = (int)state.touch_y;
+    int scroll_x = (int)state.touch_scroll_x;
+    int scroll_y = (int)state.touch_scroll_y;
+    state.touch_x -= move_x;
+    state.touch_y -= move_y;
+    state.touch_scroll_x -= scroll_x;
+    state.touch_scroll_y -= scroll_y;
+
+    x += move_x;
+    y += move_y;
+    hwheel += scroll_x;
+    wheel += scroll_y;
+}
@@ -0,0 +1,119 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+#include "gptokeyb.h"
+
+#ifdef GPTOKEYB_TRACE
+
+#include <sys/mman.h>
+#include <time.h>
+
+static trace_header* trace_ring = NULL;
+static trace_record* trace_records = NULL;
+static uint32_t trace_mask = 0;
+static size_t trace_size = 0;
+static uint16_t trace_threads = 0;
+static thread_local uint16_t trace_thread = 0;
+
+// The ring is mapped straight from the trace file, so a crash still leaves it on disk
+bool traceOpen(const char* path, uint32_t capacity)
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+        capacity = TRACE_DEFAULT_RECORDS;
+    trace_size = sizeof(trace_header) + (size_t)capacity * sizeof(trace_record);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0 || ftruncate(fd, trace_size) != 0) {
+        printf("Unable to create trace file %s: %s\n", path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    void* mem = mmap(NULL, trace_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        printf("Unable to map the trace ring: %s\n", strerror(errno));
+        return false;
+    }
+
+    // touch every page now rather than on the first records
+    memset(mem, 0, trace_size);
+    trace_ring = static_cast<trace_header*>(mem);
+    memcpy(trace_ring->magic, TRACE_MAGIC, sizeof(trace_ring->magic));
+    trace_ring->record_size = sizeof(trace_record);
+    trace_ring->capacity = capacity;
+    trace_records = reinterpret_cast<trace_record*>(trace_ring + 1);
+    trace_mask = capacity - 1;
+    trace_thread = ++trace_threads; // the main loop is thread 1
+    return true;
+}
+
+void traceClose()
+{
+    if (trace_ring == NULL)
+        return;
+
+    trace_header* ring = trace_ring;
+    trace_ring = NULL;
+    msync(ring, trace_size, MS_SYNC);
+    munmap(ring, trace_size);
+}
+
+void traceRecord(uint16_t kind, uint32_t id, int32_t a, int32_t b)
+{
+    if (trace_ring == NULL)
+        return;
+
+    if (trace_thread == 0)
+        trace_thread = __atomic_add_fetch(&trace_threads, 1, __ATOMIC_RELAXED);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    uint64_t slot = __atomic_fetch_add(&trace_ring->head, 1, __ATOMIC_RELAXED);
+    trace_record& record = trace_records[slot & trace_mask];
+    record.kind = TRACE_NONE; // a reader racing with us skips the slot until it's complete
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    record.time_ns = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    record.thread = trace_thread;
+    record.id = id;
+    record.a = a;
+    record.b = b;
+    __atomic_store_n(&record.kind, kind, __ATOMIC_RELEASE);
+}
+
+#endif /* GPTOKEYB_TRACE */
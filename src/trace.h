@@ -0,0 +1,103 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdint.h>
+
+// Binary trace ring, only built when GPTOKEYB_TRACE is defined (cmake -DGPTOKEYB_TRACE=ON).
+// Records are fixed size and written into a ring preallocated at startup, usually mmapped
+// from the file given with -trace so it survives a crash. Writers claim a slot with a single
+// atomic add and never lock or allocate. tools/trace2json.cpp turns the file into Chrome
+// trace JSON for chrome://tracing or Perfetto.
+//
+// The layout below is the file format, so it only uses fixed size types.
+
+#define TRACE_MAGIC "GPTKTRC1"
+#define TRACE_DEFAULT_RECORDS 65536 // must be a power of two
+
+enum TRACE_KIND {
+    TRACE_NONE,     // slot claimed but never finished
+    TRACE_BEGIN,    // a span starts, id is a TRACE_SPAN
+    TRACE_END,      // the matching span ends
+    TRACE_EVENT,    // SDL event received, id is the SDL event type, a/b are button or axis and value
+    TRACE_FRAME,    // events written to uinput, id is the event count, a/b are the first type and code
+    TRACE_TIMER,    // timer fired, id is the timer id (0 for the SDL key repeat timer)
+};
+
+enum TRACE_SPAN {
+    TRACE_SPAN_INPUT,       // handleInputEvent, a is the SDL event type
+    TRACE_SPAN_LOOP_TIMER,  // main loop timer callback, a is the timer id
+    TRACE_SPAN_KEY_REPEAT,  // SDL key repeat timer callback, a is the key
+    TRACE_SPAN_MOUSE_TICK,  // mouse motion frame
+    TRACE_SPAN_WAIT,        // main loop waiting for events, a is the timeout
+    TRACE_SPAN_DELAY,       // SDL_Delay on the main loop, a is the delay
+};
+
+struct trace_record
+{
+    uint64_t time_ns;   // CLOCK_MONOTONIC
+    uint16_t kind;
+    uint16_t thread;    // small per thread number, 1 is the main loop
+    uint32_t id;
+    int32_t a;
+    int32_t b;
+};
+
+struct trace_header
+{
+    char magic[8];
+    uint32_t record_size;
+    uint32_t capacity;
+    uint64_t head;      // records ever written, the newest is at (head - 1) % capacity
+};
+
+#ifdef GPTOKEYB_TRACE
+bool traceOpen(const char* path, uint32_t capacity);
+void traceClose();
+void traceRecord(uint16_t kind, uint32_t id, int32_t a, int32_t b);
+
+#define TRACE(kind, id, a, b) traceRecord((kind), (id), (a), (b))
+#else
+#define TRACE(kind, id, a, b) do {} while (0)
+#endif
+
+#define TRACE_SPAN_BEGIN(span, a) TRACE(TRACE_BEGIN, (span), (a), 0)
+#define TRACE_SPAN_END(span) TRACE(TRACE_END, (span), 0, 0)
+
+#endif /* __TRACE_H__ */
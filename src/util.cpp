@@ -37,6 +37,51 @@
 
 #include "gptokeyb.h"
 
+#define HELD_BITS_PER_LONG (sizeof(unsigned long) * 8)
+
+static unsigned long held_keys[KEY_CNT / HELD_BITS_PER_LONG + 1]; // keys and buttons currently pressed on the device
+static Uint64 held_abs = 0;     // absolute axes currently away from zero
+static Uint32 last_write_tick = 0;
+
+static void writeEventsTo(int fd, const struct input_event* ev, int count)
+{
+    for (int ii = 0; ii < count; ii++) {
+        if (ev[ii].type < EV_CNT)
+            metrics.events_out[ev[ii].type]++;
+
+        if (fd != uinp_fd) {
+            continue; // the absolute pointer has nothing to release
+        } else if (ev[ii].type == EV_KEY && ev[ii].code < KEY_CNT) {
+            unsigned long bit = 1UL << (ev[ii].code % HELD_BITS_PER_LONG);
+            if (ev[ii].value) {
+                held_keys[ev[ii].code / HELD_BITS_PER_LONG] |= bit;
+            } else {
+                held_keys[ev[ii].code / HELD_BITS_PER_LONG] &= ~bit;
+            }
+        } else if (ev[ii].type == EV_ABS && ev[ii].code < 64) {
+            if (ev[ii].value) {
+                held_abs |= (1ULL << ev[ii].code);
+            } else {
+                held_abs &= ~(1ULL << ev[ii].code);
+            }
+        }
+    }
+
+    TRACE(TRACE_FRAME, count, ev[0].type, ev[0].code);
+    ssize_t written = write(fd, ev, sizeof(ev[0]) * count);
+    metrics.uinput_writes++;
+    if (written > 0)
+        metrics.uinput_bytes += written;
+    if (written != (ssize_t)(sizeof(ev[0]) * count))
+        metrics.uinput_dropped++;
+    last_write_tick = SDL_GetTicks();
+}
+
+static void writeEvents(const struct input_event* ev, int count)
+{
+    writeEventsTo(uinp_fd, ev, count);
+}
+
 void emit(int type, int code, int val)
 {
     struct input_event ev;
@@ -48,40 +93,157 @@ void emit(int type, int code, int val)
     ev.time.tv_sec = 0;
     ev.time.tv_usec = 0;
 
-    write(uinp_fd, &ev, sizeof(ev));
+    writeEvents(&ev, 1);
 }
 
-void emitKey(int code, bool is_pressed, int modifier)
+bool isKeyHeld(int code)
 {
-    if (code == 0)
+    if (code < 0 || code >= KEY_CNT)
+        return false;
+    return (held_keys[code / HELD_BITS_PER_LONG] & (1UL << (code % HELD_BITS_PER_LONG))) != 0;
+}
+
+std::vector<int> heldKeys()
+{
+    std::vector<int> result;
+    for (int code = 0; code < KEY_CNT; code++) {
+        if (isKeyHeld(code))
+            result.push_back(code);
+    }
+    return result;
+}
+
+// Release every key and button we are holding and recentre every axis, all in one frame
+void emitReleaseAll()
+{
+    std::vector<struct input_event> events;
+    struct input_event ev;
+    memset(&ev, 0, sizeof(ev));
+
+    if (uinp_fd < 0)
         return;
 
-    if (!(modifier == 0) && is_pressed) {
-        emit(EV_KEY, modifier, is_pressed ? 1 : 0);
-        emit(EV_SYN, SYN_REPORT, 0);
+    ev.type = EV_KEY;
+    for (int code = 0; code < KEY_CNT; code++) {
+        if (isKeyHeld(code)) {
+            ev.code = code;
+            events.push_back(ev);
+        }
     }
-    emit(EV_KEY, code, is_pressed ? 1 : 0);
-    emit(EV_SYN, SYN_REPORT, 0);
-    if (!(modifier == 0) && !(is_pressed)) {
-        emit(EV_KEY, modifier, is_pressed ? 1 : 0);
-        emit(EV_SYN, SYN_REPORT, 0);
+    ev.type = EV_ABS;
+    for (int code = 0; code < 64; code++) {
+        if (held_abs & (1ULL << code)) {
+            ev.code = code;
+            events.push_back(ev);
+        }
+    }
+    if (events.empty())
+        return;
+
+    ev.type = EV_SYN;
+    ev.code = SYN_REPORT;
+    events.push_back(ev);
+    writeEvents(events.data(), events.size());
+}
+
+// Hands the description to uinput and creates the device. Kernels since 4.5 take it through
+// UI_DEV_SETUP and UI_ABS_SETUP, older ones only through a write() of the whole uinput_user_dev.
+bool createUinputDevice(int fd, const uinput_user_dev& device)
+{
+    bool legacy = true;
+#ifdef UI_DEV_SETUP
+    struct uinput_setup setup;
+    memset(&setup, 0, sizeof(setup));
+    setup.id = device.id;
+    memcpy(setup.name, device.name, UINPUT_MAX_NAME_SIZE);
+    setup.ff_effects_max = device.ff_effects_max;
+
+    if (ioctl(fd, UI_DEV_SETUP, &setup) == 0) {
+        legacy = false;
+        for (int axis = 0; axis < ABS_CNT; axis++) {
+            if (device.absmin[axis] == device.absmax[axis])
+                continue;
+
+            struct uinput_abs_setup abs_setup;
+            memset(&abs_setup, 0, sizeof(abs_setup));
+            abs_setup.code = axis;
+            abs_setup.absinfo.minimum = device.absmin[axis];
+            abs_setup.absinfo.maximum = device.absmax[axis];
+            abs_setup.absinfo.fuzz = device.absfuzz[axis];
+            abs_setup.absinfo.flat = device.absflat[axis];
+            if (ioctl(fd, UI_ABS_SETUP, &abs_setup))
+                return false;
+        }
     }
+#endif
+    if (legacy && write(fd, &device, sizeof(device)) != (ssize_t)sizeof(device))
+        return false;
+
+    return ioctl(fd, UI_DEV_CREATE) == 0;
+}
+
+// Wait until whoever reads the device has had a chance to see the last frame we wrote,
+// so destroying the device doesn't throw those events away.
+void waitOutputDrained()
+{
+    Sint32 remaining = (Sint32)(last_write_tick + config.drain_delay - SDL_GetTicks());
+    if (last_write_tick != 0 && remaining > 0)
+        SDL_Delay(remaining);
 }
 
-void emitTextInputKey(int code, bool uppercase)
+void emitKey(int code, bool is_pressed, int modifier)
 {
-    if (uppercase) { //capitalise capital letters by holding shift
-        emitKey(KEY_LEFTSHIFT, true);
+    if (code == 0)
+        return;
+
+    if (code >= TAPHOLD_CODE_BASE) {
+        tapHoldKey(code, is_pressed);
+        return;
+    }
+    if (code >= COMBO_CODE_BASE) {
+        emitCombo(code, is_pressed);
+        return;
     }
-    emitKey(code, true);
-    SDL_Delay(16);
-    emitKey(code, false);
-    SDL_Delay(16);
-    if (uppercase) { //release shift if held
-        emitKey(KEY_LEFTSHIFT, false);
+    if (code >= MACRO_CODE_BASE) {
+        if (is_pressed)
+            playMacro(code);
+        return;
     }
+
+    // the modifier goes down before the key and comes up after it, in the same frame
+    key_frame frame;
+    if (modifier != 0 && is_pressed)
+        keyFrameAdd(frame, modifier, true);
+    keyFrameAdd(frame, code, is_pressed);
+    if (modifier != 0 && !is_pressed)
+        keyFrameAdd(frame, modifier, false);
+    emitKeyFrame(frame);
 }
 
+void emitKeyFrame(const key_frame& frame)
+{
+    struct input_event ev[KEY_FRAME_MAX + 1];
+    int count = 0;
+
+    memset(ev, 0, sizeof(ev));
+    for (int ii = 0; ii < frame.count; ii++) {
+        if (frame.code[ii] == 0)
+            continue;
+        ev[count].type = EV_KEY;
+        ev[count].code = frame.code[ii];
+        ev[count].value = frame.is_pressed[ii] ? 1 : 0;
+        count++;
+    }
+    if (count == 0)
+        return;
+
+    ev[count].type = EV_SYN;
+    ev[count].code = SYN_REPORT;
+    ev[count].value = 0;
+    count++;
+
+    writeEvents(ev, count);
+}
 
 void emitAxisMotion(int code, int value)
 {
@@ -89,7 +251,40 @@ void emitAxisMotion(int code, int value)
     emit(EV_SYN, SYN_REPORT, 0);
 }
 
-void emitMouseMotion(int x, int y)
+// Moves the absolute pointer, in one frame and only if it actually moved
+void emitAbsolutePointer(int x, int y)
+{
+    struct input_event ev[3];
+    int count = 0;
+
+    if (abs_fd < 0 || (x == state.abs_x && y == state.abs_y))
+        return;
+
+    memset(ev, 0, sizeof(ev));
+    if (x != state.abs_x) {
+        ev[count].type = EV_ABS;
+        ev[count].code = ABS_X;
+        ev[count].value = x;
+        count++;
+    }
+    if (y != state.abs_y) {
+        ev[count].type = EV_ABS;
+        ev[count].code = ABS_Y;
+        ev[count].value = y;
+        count++;
+    }
+    ev[count].type = EV_SYN;
+    ev[count].code = SYN_REPORT;
+    count++;
+
+    writeEventsTo(abs_fd, ev, count);
+    state.abs_x = x;
+    state.abs_y = y;
+}
+
+// wheel and hwheel are in 1/120ths of a notch. Smooth scrolling clients use the high resolution
+// events, everything else gets a whole notch once enough has built up.
+void emitMouseMotion(int x, int y, int wheel, int hwheel)
 {
     if (x != 0) {
         emit(EV_REL, REL_X, x);
@@ -97,8 +292,24 @@ void emitMouseMotion(int x, int y)
     if (y != 0) {
         emit(EV_REL, REL_Y, y);
     }
+    if (wheel != 0) {
+        state.wheel_remainder += wheel;
+        emit(EV_REL, REL_WHEEL_HI_RES, wheel);
+        if (state.wheel_remainder / 120 != 0) {
+            emit(EV_REL, REL_WHEEL, state.wheel_remainder / 120);
+            state.wheel_remainder %= 120;
+        }
+    }
+    if (hwheel != 0) {
+        state.hwheel_remainder += hwheel;
+        emit(EV_REL, REL_HWHEEL_HI_RES, hwheel);
+        if (state.hwheel_remainder / 120 != 0) {
+            emit(EV_REL, REL_HWHEEL, state.hwheel_remainder / 120);
+            state.hwheel_remainder %= 120;
+        }
+    }
 
-    if (x != 0 || y != 0) {
+    if (x != 0 || y != 0 || wheel != 0 || hwheel != 0) {
         emit(EV_SYN, SYN_REPORT, 0);
     }
 }
@@ -348,39 +559,62 @@ short char_to_keycode(const char* str)
     return 0;
 }
 
-void doKillMode()
+// Quit through the main loop, so main() tears everything down: the ready file, the sockets,
+// the metrics file and the devices, and returns the game's exit status in supervisor mode.
+static void quitMainLoop()
 {
-    if (pckill_mode) {
-        emitKey(KEY_F4, true, KEY_LEFTALT);
-        SDL_Delay(15);
-        emitKey(KEY_F4, false, KEY_LEFTALT);
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = SDL_QUIT;
+    SDL_PushEvent(&event);
+}
+
+static void killApp()
+{
+    emitReleaseAll(); // don't leave the hotkey combo or anything else held while the game shuts down
+
+    if (child_pid > 0) { // we started the game, so signal its process group directly
+        stopChild(config.kill_timeout);
+        quitMainLoop();
+        return;
     }
 
-    SDL_RemoveTimer( state.key_repeat_timer_id );
-    if (state.start_jsdevice == state.hotkey_jsdevice) {
-        if (! sudo_kill) {
-            // printf("Killing: %s\n", AppToKill);
-            system((" killall  '" + std::string(AppToKill) + "' ").c_str());
-            system("show_splash.sh exit");
-
-            sleep(3);
-            if (system((" pgrep '" + std::string(AppToKill) + "' ").c_str()) == 0) {
-                printf("Forcefully Killing: %s\n", AppToKill);
-                system((" killall  -9 '" + std::string(AppToKill) + "' ").c_str());
-            }
+    if (! sudo_kill) {
+        // printf("Killing: %s\n", AppToKill);
+        const char* splash_argv[] = {"show_splash.sh", "exit", NULL};
+        spawnProcess(splash_argv, false);
+    }
 
-            exit(0); 
-        } else {
-            // printf("Killing: %s\n", AppToKill);
-            system((" sudo killall  '" + std::string(AppToKill) + "' ").c_str());
+    killProcesses(AppToKill, sudo_kill, config.kill_timeout);
+    if (daemonAttached()) {
+        detachDaemonSession(); // the daemon carries on for the next game
+        return;
+    }
+    quitMainLoop();
+}
 
-            sleep(3);
-            if (system((" pgrep '" + std::string(AppToKill) + "' ").c_str()) == 0) {
-                printf("Forcefully Killing: %s\n", AppToKill);
-                system((" sudo killall  -9 '" + std::string(AppToKill) + "' ").c_str());
-            }
+static int kill_timer_id = 0;
 
-            exit(0); 
-        }
-    } // sudo kill
+static Uint32 killAppCallback(Uint32, void*)
+{
+    if (keyFramesPending(STREAM_KILL))
+        return 1; // let Alt+F4 reach the app first
+
+    kill_timer_id = 0;
+    killApp();
+    return 0;
+}
+
+void doKillMode()
+{
+
+    if (pckill_mode) {
+        queueKeyTap(KEY_F4, KEY_LEFTALT, 15, STREAM_KILL);
+    }
+
+    removeLoopTimer(state.key_repeat_timer_id);
+    state.key_repeat_timer_id = 0;
+    if (kill_timer_id == 0) {
+        kill_timer_id = addLoopTimer(0, killAppCallback, NULL);
+    }
 }
@@ -77,7 +77,11 @@ void setupFakeXbox360Device(uinput_user_dev& device, int fd)
             ioctl(fd, UI_SET_ABSBIT, ABS_Z) ||
             ioctl(fd, UI_SET_ABSBIT, ABS_RZ) ||
             ioctl(fd, UI_SET_ABSBIT, ABS_HAT0X) ||
-            ioctl(fd, UI_SET_ABSBIT, ABS_HAT0Y)) {
+            ioctl(fd, UI_SET_ABSBIT, ABS_HAT0Y) ||
+            // rumble, passed on to the real controller
+            ioctl(fd, UI_SET_EVBIT, EV_FF) ||
+            ioctl(fd, UI_SET_FFBIT, FF_RUMBLE) ||
+            ioctl(fd, UI_SET_FFBIT, FF_GAIN)) {
         printf("Failed to configure fake Xbox 360 controller\n");
         exit(-1);
     }
@@ -90,6 +94,8 @@ void setupFakeXbox360Device(uinput_user_dev& device, int fd)
     UINPUT_SET_ABS_P(&device, ABS_HAT0Y, -1, 1, 0, 0);
     UINPUT_SET_ABS_P(&device, ABS_Z, 0, 255, 0, 0);
     UINPUT_SET_ABS_P(&device, ABS_RZ, 0, 255, 0, 0);
+
+    device.ff_effects_max = RUMBLE_EFFECTS_MAX;
 }
 
 
@@ -123,10 +129,6 @@ void handleEventBtnFakeXbox360Device(const SDL_Event &event, bool is_pressed)
 
     case SDL_CONTROLLER_BUTTON_LEFTSTICK:
         emitKey(BTN_THUMBL, is_pressed);
-        if (kill_mode && hotkey_override && (strcmp(hotkey_code, "l3") == 0)) {
-            state.hotkey_jsdevice = event.cdevice.which;
-            state.hotkey_pressed = is_pressed;
-        }
         break;
 
     case SDL_CONTROLLER_BUTTON_RIGHTSTICK:
@@ -135,28 +137,14 @@ void handleEventBtnFakeXbox360Device(const SDL_Event &event, bool is_pressed)
 
     case SDL_CONTROLLER_BUTTON_BACK: // aka select
         emitKey(BTN_SELECT, is_pressed);
-        if (!emuelec_override) {
-            if ((kill_mode && !(hotkey_override)) || (kill_mode && hotkey_override && (strcmp(hotkey_code, "back") == 0))) {
-                state.hotkey_jsdevice = event.cdevice.which;
-                state.hotkey_pressed = is_pressed;
-            }
-        }
         break;
 
     case SDL_CONTROLLER_BUTTON_GUIDE:
         emitKey(BTN_MODE, is_pressed);
-        if ((kill_mode && !(hotkey_override)) || (kill_mode && hotkey_override && (strcmp(hotkey_code, "guide") == 0))) {
-            state.hotkey_jsdevice = event.cdevice.which;
-            state.hotkey_pressed = is_pressed;
-        }
         break;
 
     case SDL_CONTROLLER_BUTTON_START:
         emitKey(BTN_START, is_pressed);
-        if ((kill_mode) || (textinputpreset_mode) || (textinputinteractive_mode)) {
-            state.start_jsdevice = event.cdevice.which;
-            state.start_pressed = is_pressed;
-        }
         break;
 
     case SDL_CONTROLLER_BUTTON_DPAD_UP:
@@ -176,9 +164,12 @@ void handleEventBtnFakeXbox360Device(const SDL_Event &event, bool is_pressed)
         break;
     }
 
-    if ((kill_mode) && (state.start_pressed && state.hotkey_pressed)) {
-        doKillMode();
-    } //kill mode
+    // the buttons always reach the game, the chord table only holds the kill mode combo here
+    if (is_pressed) {
+        chordButtonDown(buttonFromController(event.cbutton.button));
+    } else {
+        chordButtonUp(buttonFromController(event.cbutton.button));
+    }
 }
 
 void handleEventAxisFakeXbox360Device(const SDL_Event &event)
@@ -0,0 +1,92 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+
+#include "../src/gptokeyb.h"
+
+// Replays a -record file with gyro samples through a profile, does the main loop's mouse tick
+// after every pass and sums the pointer movement written to the virtual mouse, which here is
+// the write end of a pipe:
+//
+//   gyro_replay_test <profile.gptk> <recording.txt> <expected x> <expected y>
+
+int main(int argc, char* argv[])
+{
+    int pipe_fds[2];
+    SDL_Event event;
+
+    if (argc != 5) {
+        printf("usage: %s <profile> <recording> <expected x> <expected y>\n", argv[0]);
+        return 2;
+    }
+    if (SDL_Init(SDL_INIT_EVENTS) != 0 || pipe2(pipe_fds, O_NONBLOCK) != 0)
+        return 2;
+    uinp_fd = pipe_fds[1];
+
+    initialiseTextKeys();
+    config_mode = true;
+    readConfigFile(argv[1]);
+    if (!startReplay(argv[2]))
+        return 2;
+
+    Uint32 give_up = SDL_GetTicks() + 10000;
+    bool finished = false;
+    int x = 0, y = 0;
+    struct input_event ev;
+    while (!finished && SDL_GetTicks() < give_up) {
+        runLoopTimers();
+        if (SDL_WaitEventTimeout(&event, 1) && event.type == SDL_QUIT)
+            finished = true;
+
+        int tick_x = 0, tick_y = 0;
+        takeGyroMotion(tick_x, tick_y);
+        emitMouseMotion(tick_x, tick_y, 0, 0);
+
+        while (read(pipe_fds[0], &ev, sizeof(ev)) == sizeof(ev)) {
+            if (ev.type == EV_REL && ev.code == REL_X)
+                x += ev.value;
+            else if (ev.type == EV_REL && ev.code == REL_Y)
+                y += ev.value;
+        }
+    }
+
+    int expected_x = atoi(argv[3]);
+    int expected_y = atoi(argv[4]);
+    printf("gyro_replay_test: moved %d,%d, expected %d,%d\n", x, y, expected_x, expected_y);
+    return (finished && x == expected_x && y == expected_y) ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "../src/gptokeyb.h"
+
+#include <stdarg.h>
+
+// Rumble passthrough with a stand-in for the uinput side: the test is linked with
+// -Wl,--wrap=ioctl,--wrap=SDL_GameControllerRumble, so the UI_BEGIN/END_FF_* requests and the
+// rumble sent to the controller are answered and recorded here instead.
+
+#define CHECK(cond) \
+    if (!(cond)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); failures++; }
+
+static int failures = 0;
+
+static ff_effect pending_effect;    // what the next UI_BEGIN_FF_UPLOAD hands us
+static int pending_erase = 0;       // the effect the next UI_BEGIN_FF_ERASE asks to erase
+static int last_retval = 1;         // from the last UI_END_FF_*
+static int rumble_calls = 0;
+static Uint16 rumble_low = 0, rumble_high = 0;
+static Uint32 rumble_duration = 0;
+
+extern "C" int __real_ioctl(int fd, unsigned long request, ...);
+
+extern "C" int __wrap_ioctl(int fd, unsigned long request, ...)
+{
+    va_list args;
+    va_start(args, request);
+    void* arg = va_arg(args, void*);
+    va_end(args);
+
+    switch (request) {
+    case UI_BEGIN_FF_UPLOAD:
+        static_cast<uinput_ff_upload*>(arg)->effect = pending_effect;
+        return 0;
+    case UI_END_FF_UPLOAD:
+        last_retval = static_cast<uinput_ff_upload*>(arg)->retval;
+        return 0;
+    case UI_BEGIN_FF_ERASE:
+        static_cast<uinput_ff_erase*>(arg)->effect_id = pending_erase;
+        return 0;
+    case UI_END_FF_ERASE:
+        last_retval = static_cast<uinput_ff_erase*>(arg)->retval;
+        return 0;
+    }
+    return __real_ioctl(fd, request, arg);
+}
+
+extern "C" int __wrap_SDL_GameControllerRumble(SDL_GameController*, Uint16 low, Uint16 high, Uint32 duration)
+{
+    rumble_calls++;
+    rumble_low = low;
+    rumble_high = high;
+    rumble_duration = duration;
+    return 0;
+}
+
+static void sendEvent(int type, int code, int value)
+{
+    struct input_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = type;
+    ev.code = code;
+    ev.value = value;
+    handleRumbleEvent(-1, ev);
+}
+
+static void upload(int id, int type, int strong, int weak, int length)
+{
+    memset(&pending_effect, 0, sizeof(pending_effect));
+    pending_effect.type = type;
+    pending_effect.id = id;
+    pending_effect.u.rumble.strong_magnitude = strong;
+    pending_effect.u.rumble.weak_magnitude = weak;
+    pending_effect.replay.length = length;
+    last_retval = 1;
+    sendEvent(EV_UINPUT, UI_FF_UPLOAD, 7);
+}
+
+int main()
+{
+    rumbleControllerAdded(reinterpret_cast<SDL_GameController*>(&pending_effect)); // never dereferenced
+
+    // a rumble effect is accepted and played at full gain
+    upload(3, FF_RUMBLE, 0x8000, 0x4000, 250);
+    CHECK(last_retval == 0);
+    sendEvent(EV_FF, 3, 1);
+    CHECK(rumble_calls == 1 && rumble_low == 0x8000 && rumble_high == 0x4000 && rumble_duration == 250);
+
+    // repeats lengthen it, gain scales it, and a count of 0 stops it
+    sendEvent(EV_FF, FF_GAIN, 0x8000);
+    sendEvent(EV_FF, 3, 2);
+    CHECK(rumble_calls == 2 && rumble_low == 0x4000 && rumble_high == 0x2000 && rumble_duration == 500);
+    sendEvent(EV_FF, 3, 0);
+    CHECK(rumble_calls == 3 && rumble_low == 0 && rumble_high == 0);
+
+    // an effect with no length plays until it is stopped
+    upload(4, FF_RUMBLE, 0xFFFF, 0, 0);
+    CHECK(last_retval == 0);
+    sendEvent(EV_FF, 4, 1);
+    CHECK(rumble_calls == 4 && rumble_duration == 0xFFFF);
+
+    // other effect types and ids outside the table are refused
+    upload(5, FF_PERIODIC, 0, 0, 100);
+    CHECK(last_retval == -EINVAL);
+    upload(RUMBLE_EFFECTS_MAX, FF_RUMBLE, 0x8000, 0x8000, 100);
+    CHECK(last_retval == -EINVAL);
+    sendEvent(EV_FF, 5, 1);
+    CHECK(rumble_calls == 4);
+
+    // an erased effect doesn't play any more
+    pending_erase = 3;
+    last_retval = 1;
+    sendEvent(EV_UINPUT, UI_FF_ERASE, 8);
+    CHECK(last_retval == 0);
+    sendEvent(EV_FF, 3, 1);
+    CHECK(rumble_calls == 4);
+
+    // nothing is sent once the controller is gone
+    rumbleControllerRemoved(reinterpret_cast<SDL_GameController*>(&pending_effect));
+    sendEvent(EV_FF, 4, 1);
+    CHECK(rumble_calls == 4);
+
+    printf("rumble_test: %s\n", failures == 0 ? "passed" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+
+#include "../src/gptokeyb.h"
+
+// Replays a -record file through a profile and counts the key events that reach the virtual
+// keyboard, which here is the write end of a pipe:
+//
+//   stick_replay_test <profile.gptk> <recording.txt> <expected key events>
+
+int main(int argc, char* argv[])
+{
+    int pipe_fds[2];
+    SDL_Event event;
+
+    if (argc != 4) {
+        printf("usage: %s <profile> <recording> <expected key events>\n", argv[0]);
+        return 2;
+    }
+    if (SDL_Init(SDL_INIT_EVENTS) != 0 || pipe2(pipe_fds, O_NONBLOCK) != 0)
+        return 2;
+    uinp_fd = pipe_fds[1];
+
+    initialiseTextKeys();
+    config_mode = true;
+    readConfigFile(argv[1]);
+    if (!startReplay(argv[2]))
+        return 2;
+
+    // a main loop without the controller, until the replay asks to quit
+    Uint32 give_up = SDL_GetTicks() + 10000;
+    bool finished = false;
+    while (!finished && SDL_GetTicks() < give_up) {
+        runLoopTimers();
+        if (SDL_WaitEventTimeout(&event, 5) && event.type == SDL_QUIT)
+            finished = true;
+    }
+    SDL_Delay(config.left_analog_min_hold + 10);
+    runLoopTimers(); // a key still kept down by the minimum hold
+
+    struct input_event ev;
+    int count = 0;
+    while (read(pipe_fds[0], &ev, sizeof(ev)) == sizeof(ev)) {
+        if (ev.type == EV_KEY) {
+            printf("%d %s\n", ev.code, ev.value ? "down" : "up");
+            count++;
+        }
+    }
+
+    int expected = atoi(argv[3]);
+    printf("stick_replay_test: %d key events, expected %d\n", count, expected);
+    return (finished && count == expected) ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+/* Copyright (c) 2021-2023
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation; either
+* version 2 of the License, or (at your option) any later version.
+#
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+#
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the
+* Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA 02110-1301 USA
+#
+* Authored by: Kris Henriksen <krishenriksen.work@gmail.com>
+#
+* AnberPorts-Keyboard-Mouse
+* 
+* Part of the code is from from https://github.com/krishenriksen/AnberPorts/blob/master/AnberPorts-Keyboard-Mouse/main.c (mostly the fake keyboard)
+* Fake Xbox code from: https://github.com/Emanem/js2xbox
+* 
+* Modified (badly) by: Shanti Gilbert for EmuELEC
+* Modified further by: Nikolai Wuttke for EmuELEC (Added support for SDL and the SDLGameControllerdb.txt)
+* Modified further by: Jacob Smith
+* 
+* Any help improving this code would be greatly appreciated! 
+* 
+* DONE: Xbox360 mode: Fix triggers so that they report from 0 to 255 like real Xbox triggers
+*       Xbox360 mode: Figure out why the axis are not correctly labeled?  SDL_CONTROLLER_AXIS_RIGHTX / SDL_CONTROLLER_AXIS_RIGHTY / SDL_CONTROLLER_AXIS_TRIGGERLEFT / SDL_CONTROLLER_AXIS_TRIGGERRIGHT
+*       Keyboard mode: Add a config file option to load mappings from.
+*       add L2/R2 triggers
+* 
+*/
+
+// Converts a trace file written by gptokeyb -trace into Chrome trace JSON, which can be
+// opened with chrome://tracing or https://ui.perfetto.dev
+//
+//   trace2json gptokeyb.trace > gptokeyb.json
+
+#include <algorithm>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "../src/trace.h"
+
+static const char* spanName(uint32_t span)
+{
+    switch (span) {
+    case TRACE_SPAN_INPUT:      return "handleInputEvent";
+    case TRACE_SPAN_LOOP_TIMER: return "loop timer";
+    case TRACE_SPAN_KEY_REPEAT: return "key repeat timer";
+    case TRACE_SPAN_MOUSE_TICK: return "mouse tick";
+    case TRACE_SPAN_WAIT:       return "wait for events";
+    case TRACE_SPAN_DELAY:      return "SDL_Delay";
+    }
+    return "span";
+}
+
+// Event type numbers from SDL_events.h, so this doesn't need SDL to build
+static const char* eventName(uint32_t type)
+{
+    switch (type) {
+    case 0x100: return "SDL_QUIT";
+    case 0x650: return "SDL_CONTROLLERAXISMOTION";
+    case 0x651: return "SDL_CONTROLLERBUTTONDOWN";
+    case 0x652: return "SDL_CONTROLLERBUTTONUP";
+    case 0x653: return "SDL_CONTROLLERDEVICEADDED";
+    case 0x654: return "SDL_CONTROLLERDEVICEREMOVED";
+    case 0x655: return "SDL_CONTROLLERDEVICEREMAPPED";
+    }
+    return type >= 0x8000 ? "SDL_USEREVENT" : "SDL event";
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <trace file>\n", argv[0]);
+        return 1;
+    }
+
+    FILE* fp = fopen(argv[1], "rb");
+    if (fp == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    trace_header header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+        || header.record_size != sizeof(trace_record) || header.capacity == 0) {
+        fprintf(stderr, "%s is not a gptokeyb trace\n", argv[1]);
+        fclose(fp);
+        return 1;
+    }
+
+    std::vector<trace_record> ring(header.capacity);
+    size_t count = fread(ring.data(), sizeof(trace_record), header.capacity, fp);
+    fclose(fp);
+    ring.resize(count);
+
+    // oldest first; once the ring has wrapped the oldest record is the one after the newest
+    std::vector<trace_record> records;
+    uint64_t written = header.head < count ? header.head : count;
+    for (uint64_t slot = header.head - written; slot < header.head; slot++) {
+        const trace_record& record = ring[slot % header.capacity];
+        if (record.kind != TRACE_NONE && record.time_ns != 0)
+            records.push_back(record);
+    }
+    std::stable_sort(records.begin(), records.end(), [](const trace_record& lhs, const trace_record& rhs) {
+        return lhs.time_ns < rhs.time_ns;
+    });
+
+    uint64_t start_ns = records.empty() ? 0 : records.front().time_ns;
+    std::map<uint16_t, int> depth; // spans open on each thread, to drop ends whose begin was overwritten
+    bool first = true;
+
+    printf("{\"traceEvents\":[\n");
+    for (const trace_record& record : records) {
+        char line[512];
+        double ts = (record.time_ns - start_ns) / 1000.0;
+
+        switch (record.kind) {
+        case TRACE_BEGIN:
+            depth[record.thread]++;
+            snprintf(line, sizeof(line), "{\"name\":\"%s\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"arg\":%d}}",
+                spanName(record.id), ts, record.thread, record.a);
+            break;
+        case TRACE_END:
+            if (depth[record.thread] == 0)
+                continue;
+            depth[record.thread]--;
+            snprintf(line, sizeof(line), "{\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}", ts, record.thread);
+            break;
+        case TRACE_EVENT:
+            snprintf(line, sizeof(line), "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"type\":%u,\"which\":%d,\"value\":%d}}",
+                eventName(record.id), ts, record.thread, record.id, record.a, record.b);
+            break;
+        case TRACE_FRAME:
+            snprintf(line, sizeof(line), "{\"name\":\"uinput write\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"events\":%u,\"type\":%d,\"code\":%d}}",
+                ts, record.thread, record.id, record.a, record.b);
+            break;
+        case TRACE_TIMER:
+            snprintf(line, sizeof(line), "{\"name\":\"timer\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"id\":%u,\"arg\":%d}}",
+                ts, record.thread, record.id, record.a);
+            break;
+        default:
+            continue;
+        }
+
+        printf("%s%s", first ? "" : ",\n", line);
+        first = false;
+    }
+    printf("\n]}\n");
+    return 0;
+}